@@ -9,6 +9,8 @@
 #include <stdlib.h>
 #include <string.h>
 #include <time.h>
+#include <memory>
+#include <unordered_map>
 
 #include "../common/cbasetypes.hpp"
 #include "../common/cli.hpp"
@@ -22,6 +24,7 @@
 #include "../common/socket.hpp"
 #include "../common/strlib.hpp"
 #include "../common/timer.hpp"
+#include "../common/utilities.hpp"
 
 #include "char_clif.hpp"
 #include "char_cnslif.hpp"
@@ -75,6 +78,97 @@ DBMap* char_get_authdb() { return auth_db; }
 DBMap* char_get_onlinedb() { return online_char_db; }
 DBMap* char_get_chardb() { return char_db_; }
 
+static std::unordered_map<uint32, uint32> char_save_versions; // uint32 char_id -> version of the status last saved by the map-server
+
+/// Last saved status of a recently logged out character
+struct s_char_relog_cache {
+	struct mmo_charstatus status;
+	t_tick expire;
+};
+static std::unordered_map<uint32, std::shared_ptr<struct s_char_relog_cache>> char_relog_cache; // uint32 char_id -> cached status
+
+/**
+ * Keep the last saved status of a character that logs out, so a relog within relog_cache_time does not need to read its secondary data again
+ * @param cp: status as it was last saved
+ */
+static void char_relog_cache_add(struct mmo_charstatus* cp){
+	if( charserv_config.relog_cache_time <= 0 )
+		return;
+
+	std::shared_ptr<struct s_char_relog_cache> entry = std::make_shared<struct s_char_relog_cache>();
+
+	memcpy(&entry->status, cp, sizeof(struct mmo_charstatus));
+	entry->expire = gettick() + charserv_config.relog_cache_time * 1000;
+	char_relog_cache[cp->char_id] = entry;
+}
+
+/**
+ * Take the cached status of a character out of the relog cache
+ * @param char_id: character to look up
+ * @return cached status or nullptr if there is none or it expired
+ */
+static std::shared_ptr<struct s_char_relog_cache> char_relog_cache_pop(uint32 char_id){
+	std::shared_ptr<struct s_char_relog_cache> entry = rathena::util::umap_find(char_relog_cache, char_id);
+
+	if( entry == nullptr )
+		return nullptr;
+
+	char_relog_cache.erase(char_id);
+
+	if( DIFF_TICK(entry->expire, gettick()) <= 0 )
+		return nullptr;
+
+	return entry;
+}
+
+/**
+ * Drop the cached status of a character whose data was changed while offline.
+ * Characters that list it as a friend are dropped too, since they cache its name.
+ * @param char_id: character that was changed
+ */
+void char_relog_cache_invalidate(uint32 char_id){
+	for( auto it = char_relog_cache.begin(); it != char_relog_cache.end(); ){
+		struct mmo_charstatus* status = &it->second->status;
+		int i;
+
+		ARR_FIND( 0, MAX_FRIENDS, i, status->friends[i].char_id == char_id );
+
+		if( it->first == char_id || i < MAX_FRIENDS )
+			it = char_relog_cache.erase(it);
+		else
+			it++;
+	}
+}
+
+TIMER_FUNC(char_relog_cache_cleanup){
+	for( auto it = char_relog_cache.begin(); it != char_relog_cache.end(); ){
+		if( DIFF_TICK(it->second->expire, tick) <= 0 )
+			it = char_relog_cache.erase(it);
+		else
+			it++;
+	}
+
+	return 0;
+}
+
+/**
+ * Version of the status last saved for a character by its map-server
+ * @param char_id: Character ID
+ * @return Version or 0 if the char-server has no valid base for delta saves
+ */
+uint32 char_get_saveversion(uint32 char_id) {
+	auto it = char_save_versions.find(char_id);
+
+	return it != char_save_versions.end() ? it->second : 0;
+}
+
+void char_set_saveversion(uint32 char_id, uint32 version) {
+	if (version == 0)
+		char_save_versions.erase(char_id);
+	else
+		char_save_versions[char_id] = version;
+}
+
 /**
  * @see DBCreateData
  */
@@ -160,8 +254,11 @@ void char_set_char_offline(uint32 char_id, uint32 account_id){
 	{
 		struct mmo_charstatus* cp = (struct mmo_charstatus*)idb_get(char_db_,char_id);
 		inter_guild_CharOffline(char_id, cp?cp->guild_id:-1);
-		if (cp)
+		if (cp){
+			char_relog_cache_add(cp);
 			idb_remove(char_db_,char_id);
+		}
+		char_set_saveversion(char_id, 0);
 
 		if( SQL_ERROR == Sql_Query(sql_handle, "UPDATE `%s` SET `online`='0' WHERE `char_id`='%d' LIMIT 1", schema_config.char_db, char_id) )
 			Sql_ShowDebug(sql_handle);
@@ -265,6 +362,12 @@ DBData char_create_charstatus(DBKey key, va_list args) {
 	return db_ptr2data(cp);
 }
 
+/**
+ * Saves the parts of a character status that differ from the cached status
+ * @param char_id: Character ID
+ * @param p: Status to save
+ * @return 0 on success, -1 if anything could not be saved
+ */
 int char_mmo_char_tosql(uint32 char_id, struct mmo_charstatus* p){
 	int i = 0;
 	int count = 0;
@@ -274,7 +377,7 @@ int char_mmo_char_tosql(uint32 char_id, struct mmo_charstatus* p){
 	int errors = 0; //If there are any errors while saving, "cp" will not be updated at the end.
 	StringBuf buf;
 
-	if (char_id!=p->char_id) return 0;
+	if (char_id!=p->char_id) return -1;
 
 	cp = (struct mmo_charstatus *)idb_ensure(char_db_, char_id, char_create_charstatus);
 
@@ -524,8 +627,9 @@ int char_mmo_char_tosql(uint32 char_id, struct mmo_charstatus* p){
 	StringBuf_Destroy(&buf);
 	if (save_status[0]!='\0' && charserv_config.save_log)
 		ShowInfo("Saved char %d - %s:%s.\n", char_id, p->name, save_status);
-	if (!errors)
-		memcpy(cp, p, sizeof(struct mmo_charstatus));
+	if (errors)
+		return -1;
+	memcpy(cp, p, sizeof(struct mmo_charstatus));
 	return 0;
 }
 
@@ -1186,6 +1290,67 @@ int char_mmo_char_fromsql(uint32 char_id, struct mmo_charstatus* p, bool load_ev
 		return 1;
 	}
 
+	// Relog: take everything besides the status from the data saved at logout, it cannot have changed since
+	std::shared_ptr<struct s_char_relog_cache> cached = char_relog_cache_pop(char_id);
+
+	if( cached != nullptr ){
+		struct mmo_charstatus* c = &cached->status;
+		int count;
+
+		// Same layout as when reading it from the tables
+		for( i = 0, count = 0; i < MAX_MEMOPOINTS; i++ ){
+			if( c->memo_point[i].map )
+				memcpy(&p->memo_point[count++], &c->memo_point[i], sizeof(struct point));
+		}
+		StringBuf_AppendStr(&msg_buf, " memo");
+
+		for( i = 0; i < MAX_SKILL; i++ ){
+			struct s_skill* skill = &c->skill[i];
+
+			if( skill->id == 0 || skill->flag == SKILL_FLAG_TEMPORARY )
+				continue;
+			if( skill->lv == 0 && ( skill->flag == SKILL_FLAG_PERM_GRANTED || skill->flag == SKILL_FLAG_PERMANENT ) )
+				continue;
+			if( skill->flag != SKILL_FLAG_PERMANENT && skill->flag != SKILL_FLAG_PERM_GRANTED && (skill->flag - SKILL_FLAG_REPLACED_LV_0) == 0 )
+				continue;
+
+			p->skill[skill_count].id = skill->id;
+			p->skill[skill_count].lv = ( (skill->flag == SKILL_FLAG_PERMANENT || skill->flag == SKILL_FLAG_PERM_GRANTED) ? skill->lv : skill->flag - SKILL_FLAG_REPLACED_LV_0 );
+			p->skill[skill_count].flag = ( skill->flag == SKILL_FLAG_PERM_GRANTED ? SKILL_FLAG_PERM_GRANTED : SKILL_FLAG_PERMANENT );
+			skill_count++;
+		}
+		StringBuf_Printf(&msg_buf, " %d skills", skill_count);
+
+		for( i = 0, count = 0; i < MAX_FRIENDS; i++ ){
+			if( c->friends[i].char_id > 0 )
+				memcpy(&p->friends[count++], &c->friends[i], sizeof(struct s_friend));
+		}
+		StringBuf_AppendStr(&msg_buf, " friends");
+
+#ifdef HOTKEY_SAVING
+		memcpy(p->hotkeys, c->hotkeys, sizeof(p->hotkeys));
+		StringBuf_AppendStr(&msg_buf, " hotkeys");
+#endif
+
+		p->mer_id = c->mer_id;
+		p->arch_calls = c->arch_calls;
+		p->arch_faith = c->arch_faith;
+		p->spear_calls = c->spear_calls;
+		p->spear_faith = c->spear_faith;
+		p->sword_calls = c->sword_calls;
+		p->sword_faith = c->sword_faith;
+		StringBuf_AppendStr(&msg_buf, " mercenary (relog cache)");
+
+		if (charserv_config.save_log)
+			ShowInfo("Loaded char (%d - %s): %s\n", char_id, p->name, StringBuf_Value(&msg_buf));
+		SqlStmt_Free(stmt);
+
+		cp = (struct mmo_charstatus *)idb_ensure(char_db_, char_id, char_create_charstatus);
+		memcpy(cp, p, sizeof(struct mmo_charstatus));
+		StringBuf_Destroy(&msg_buf);
+		return 1;
+	}
+
 	//read memo data
 	//`memo` (`memo_id`,`char_id`,`map`,`x`,`y`)
 	if( SQL_ERROR == SqlStmt_Prepare(stmt, "SELECT `map`,`x`,`y` FROM `%s` WHERE `char_id`=? ORDER by `memo_id` LIMIT %d", schema_config.memo_db, MAX_MEMOPOINTS)
@@ -1341,6 +1506,7 @@ int char_rename_char_sql(struct char_session_data *sd, uint32 char_id)
 		Sql_ShowDebug(sql_handle);
 		return 3;
 	}
+	char_relog_cache_invalidate(char_id);
 	
 	// Update party and party members with the new player name
 	if( char_dat.party_id )
@@ -1657,6 +1823,8 @@ enum e_char_del_response char_delete(struct char_session_data* sd, uint32 char_i
 			Sql_ShowDebug(sql_handle);
 		if( SQL_ERROR == Sql_Query(sql_handle, "DELETE FROM `%s` WHERE `id` = '410' AND (`char_id`='%d' OR `char_id`='%d')", schema_config.skill_db, father_id, mother_id) )
 			Sql_ShowDebug(sql_handle);
+		char_relog_cache_invalidate(father_id);
+		char_relog_cache_invalidate(mother_id);
 
 		WBUFW(buf,0) = 0x2b25;
 		WBUFL(buf,2) = father_id;
@@ -1691,6 +1859,9 @@ enum e_char_del_response char_delete(struct char_session_data* sd, uint32 char_i
 	/* remove mercenary data */
 	mercenary_owner_delete(char_id);
 
+	/* drop cached data of the char and of everyone listing it as friend */
+	char_relog_cache_invalidate(char_id);
+
 	/* delete char's friends list */
 	if( SQL_ERROR == Sql_Query(sql_handle, "DELETE FROM `%s` WHERE `char_id` = '%d'", schema_config.friend_db, char_id) )
 		Sql_ShowDebug(sql_handle);
@@ -2811,6 +2982,7 @@ void char_set_defaults(){
 	charserv_config.default_map_y = 191;
 
 	charserv_config.clan_remove_inactive_days = 14;
+	charserv_config.relog_cache_time = 60;
 	charserv_config.mail_return_days = 14;
 	charserv_config.mail_delete_days = 14;
 	charserv_config.mail_retrieve = 1;
@@ -3095,6 +3267,8 @@ bool char_config_read(const char* cfgName, bool normal){
 			charserv_config.default_map_y = atoi(w2);
 		} else if (strcmpi(w1, "clan_remove_inactive_days") == 0) {
 			charserv_config.clan_remove_inactive_days = atoi(w2);
+		} else if (strcmpi(w1, "relog_cache_time") == 0) {
+			charserv_config.relog_cache_time = atoi(w2);
 		} else if (strcmpi(w1, "mail_return_days") == 0) {
 			charserv_config.mail_return_days = atoi(w2);
 		} else if (strcmpi(w1, "mail_delete_days") == 0) {
@@ -3261,6 +3435,7 @@ int do_init(int argc, char **argv)
 
 	// periodically update the overall user count on all mapservers + login server
 	add_timer_func_list(chlogif_broadcast_user_count, "broadcast_user_count");
+	add_timer_func_list(charblock_timer, "charblock_timer");
 	add_timer_interval(gettick() + 1000, chlogif_broadcast_user_count, 0, 0, 5 * 1000);
 
 	// Timer to clear (online_char_db)
@@ -3270,6 +3445,10 @@ int do_init(int argc, char **argv)
 	add_timer_func_list(char_online_data_cleanup, "online_data_cleanup");
 	add_timer_interval(gettick() + 1000, char_online_data_cleanup, 0, 0, 600 * 1000);
 
+	// periodically drop expired entries of the relog cache
+	add_timer_func_list(char_relog_cache_cleanup, "relog_cache_cleanup");
+	add_timer_interval(gettick() + 1000, char_relog_cache_cleanup, 0, 0, 60 * 1000);
+
 	// periodically remove players that have not logged in for a long time from clans
 	add_timer_func_list(char_clan_member_cleanup, "clan_member_cleanup");
 	add_timer_interval(gettick() + 1000, char_clan_member_cleanup, 0, 0, 60 * 60 * 1000); // every 60 minutes
@@ -188,6 +188,7 @@ struct CharServ_Config {
 	unsigned short default_map_y;
 
 	int clan_remove_inactive_days;
+	int relog_cache_time;
 	int mail_return_days;
 	int mail_delete_days;
 	int mail_retrieve;
@@ -261,6 +262,8 @@ struct char_session_data {
 
 struct mmo_charstatus;
 DBMap* char_get_chardb(); // uint32 char_id -> struct mmo_charstatus*
+uint32 char_get_saveversion(uint32 char_id);
+void char_set_saveversion(uint32 char_id, uint32 version);
 
 //Custom limits for the fame lists. [Skotlex]
 extern int fame_list_size_chemist;
@@ -282,6 +285,7 @@ DBData char_create_online_data(DBKey key, va_list args);
 int char_db_setoffline(DBKey key, DBData *data, va_list ap);
 void char_set_char_online(int map_id, uint32 char_id, uint32 account_id);
 void char_set_char_offline(uint32 char_id, uint32 account_id);
+void char_relog_cache_invalidate(uint32 char_id);
 void char_set_all_offline(int id);
 void char_disconnect_player(uint32 account_id);
 TIMER_FUNC(char_chardb_waiting_disconnect);
@@ -53,4 +53,6 @@ void chclif_block_character( int fd, struct char_session_data* sd);
 
 int chclif_parse(int fd);
 
+TIMER_FUNC(charblock_timer);
+
 #endif /* CHAR_CLIF_HPP */
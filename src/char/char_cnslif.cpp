@@ -86,12 +86,16 @@ int cnslif_parse(const char* buf)
 	else if( strcmpi("ers_report", type) == 0 ){
 		ers_report();
 	}
+	else if( n == 2 && strcmpi("tick_metrics", type) == 0 ){
+		tick_metrics_console(command);
+	}
 	else if( strcmpi("help", type) == 0 ){
 		ShowInfo("Available commands:\n");
 		ShowInfo("\t server:shutdown => Stops the server.\n");
 		ShowInfo("\t server:alive => Checks if the server is running.\n");
 		ShowInfo("\t server:reloadconf => Reload config file: \"%s\"\n", CHAR_CONF_NAME);
 		ShowInfo("\t ers_report => Displays database usage.\n");
+		ShowInfo("\t tick_metrics:on|off|reset|report [limit]|slow <ms>|export <file> => Times the main loop phases and timer functions.\n");
 	}
 
 	return 0;
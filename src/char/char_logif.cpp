@@ -825,7 +825,15 @@ void chlogif_check_shutdown(void)
 
 /// Called when the connection to Login Server is disconnected.
 void chlogif_on_disconnect(void){
+	int fd;
+
 	ShowWarning("Connection to Login Server lost.\n\n");
+
+	// disconnect the players right away, chclif_parse only runs for clients that sent something
+	for( fd = 1; fd < fd_max; fd++ ){
+		if( session_isActive( fd ) && session[fd]->func_parse == chclif_parse )
+			set_eof( fd );
+	}
 }
 
 /// Called when all the connection steps are completed.
@@ -396,9 +396,9 @@ int chmapif_parse_reqsavechar(int fd, int id){
 		struct online_char_data* character;
 		DBMap* online_char_db = char_get_onlinedb();
 
-		if (size - 13 != sizeof(struct mmo_charstatus))
+		if (size - 17 != sizeof(struct mmo_charstatus))
 		{
-			ShowError("parse_from_map (save-char): Size mismatch! %d != %" PRIuPTR "\n", size-13, sizeof(struct mmo_charstatus));
+			ShowError("parse_from_map (save-char): Size mismatch! %d != %" PRIuPTR "\n", size-17, sizeof(struct mmo_charstatus));
 			RFIFOSKIP(fd,size);
 			return 1;
 		}
@@ -409,7 +409,10 @@ int chmapif_parse_reqsavechar(int fd, int id){
 		{
 			struct mmo_charstatus char_dat;
 			memcpy(&char_dat, RFIFOP(fd,13), sizeof(struct mmo_charstatus));
-			char_mmo_char_tosql(cid, &char_dat);
+			if (char_mmo_char_tosql(cid, &char_dat) == 0)
+				char_set_saveversion(cid, RFIFOL(fd,size - 4));
+			else
+				char_set_saveversion(cid, 0);
 		} else {	//This may be valid on char-server reconnection, when re-sending characters that already logged off.
 			ShowError("parse_from_map (save-char): Received data for non-existant/offline character (%d:%d).\n", aid, cid);
 			char_set_char_online(id, cid, aid);
@@ -429,6 +432,95 @@ int chmapif_parse_reqsavechar(int fd, int id){
 	return 1;
 }
 
+/**
+ * Tell the map-server that a delta save could not be applied and the complete status is needed
+ * @param fd: wich fd to send to
+ * @param aid: Player account id
+ * @param cid: Player char id
+ */
+void chmapif_save_resync(int fd, uint32 aid, uint32 cid){
+	WFIFOHEAD(fd,10);
+	WFIFOW(fd,0) = 0x2b2c;
+	WFIFOL(fd,2) = aid;
+	WFIFOL(fd,6) = cid;
+	WFIFOSET(fd,10);
+}
+
+/**
+ * Map-serv request to save the changed parts of mmo_char_status in sql
+ * The changed blocks are applied on the cached status of the base version, which must be the last one saved
+ * @param fd: wich fd to parse from
+ * @param id: wich map_serv id
+ * @return : 0 not enough data received, 1 success
+ */
+int chmapif_parse_reqsavechar_delta(int fd, int id){
+	if (RFIFOREST(fd) < 4 || RFIFOREST(fd) < RFIFOW(fd,2))
+		return 0;
+	else {
+		uint32 aid = RFIFOL(fd,4), cid = RFIFOL(fd,8), base_version = RFIFOL(fd,12), version = RFIFOL(fd,16);
+		int size = RFIFOW(fd,2);
+		const int blocks = (sizeof(struct mmo_charstatus) + CHARSAVE_DELTA_BLOCK - 1) / CHARSAVE_DELTA_BLOCK;
+		const int mask_len = (blocks + 7) / 8;
+		struct online_char_data* character = (struct online_char_data*)idb_get(char_get_onlinedb(), aid);
+		struct mmo_charstatus* cp = (struct mmo_charstatus*)idb_get(char_get_chardb(), cid);
+
+		if (RFIFOW(fd,20) != sizeof(struct mmo_charstatus) || size < 22 + mask_len)
+		{
+			ShowError("parse_from_map (save-char-delta): Size mismatch! %d != %" PRIuPTR "\n", RFIFOW(fd,20), sizeof(struct mmo_charstatus));
+			RFIFOSKIP(fd,size);
+			return 1;
+		}
+
+		if (character == NULL || character->char_id != cid) {
+			ShowError("parse_from_map (save-char-delta): Received data for non-existant/offline character (%d:%d).\n", aid, cid);
+			char_set_char_online(id, cid, aid);
+			cp = NULL;
+		}
+
+		if (cp == NULL || base_version == 0 || char_get_saveversion(cid) != base_version) {
+			// Our copy is not the one the map-server built the delta on
+			char_set_saveversion(cid, 0);
+			chmapif_save_resync(fd, aid, cid);
+			RFIFOSKIP(fd,size);
+			return 1;
+		}
+
+		struct mmo_charstatus char_dat;
+		const uint8* mask = RFIFOP(fd,22);
+		int pos = 22 + mask_len;
+
+		memcpy(&char_dat, cp, sizeof(struct mmo_charstatus));
+
+		for (int i = 0; i < blocks; i++) {
+			if (!(mask[i / 8] & (1 << (i % 8))))
+				continue;
+
+			int offset = i * CHARSAVE_DELTA_BLOCK;
+			int len = min(CHARSAVE_DELTA_BLOCK, sizeof(struct mmo_charstatus) - offset);
+
+			if (pos + len > size)
+				break;
+
+			memcpy((uint8*)&char_dat + offset, RFIFOP(fd,pos), len);
+			pos += len;
+		}
+
+		if (pos != size || char_dat.char_id != cid) {
+			ShowError("parse_from_map (save-char-delta): Malformed delta for character (%d:%d).\n", aid, cid);
+			char_set_saveversion(cid, 0);
+			chmapif_save_resync(fd, aid, cid);
+		} else if (char_mmo_char_tosql(cid, &char_dat) == 0) {
+			char_set_saveversion(cid, version);
+		} else {
+			char_set_saveversion(cid, 0);
+			chmapif_save_resync(fd, aid, cid);
+		}
+
+		RFIFOSKIP(fd,size);
+	}
+	return 1;
+}
+
 /**
  * Inform mapserv of a new character selection request
  * @param fd : FD link tomapserv
@@ -673,6 +765,8 @@ int chmapif_parse_askrmfriend(int fd){
 			Sql_ShowDebug(sql_handle);
 			return 1;
 		}
+		// The character is offline, its cached data would bring the friend back on relog
+		char_relog_cache_invalidate(char_id);
 		RFIFOSKIP(fd,10);
 	}
 	return 1;
@@ -1426,8 +1520,8 @@ int chmapif_parse(int fd){
 			case 0x2b23: next=chmapif_parse_keepalive(fd); break;
 			case 0x2b26: next=chmapif_parse_reqauth(fd,id); break;
 			case 0x2b28: next=chmapif_parse_reqcharban(fd); break; //charban
+			case 0x2b29: next=chmapif_parse_reqsavechar_delta(fd,id); break;
 			case 0x2b2a: next=chmapif_parse_reqcharunban(fd); break; //charunban
-			//case 0x2b2c: /*free*/; break;
 			case 0x2b2d: next=chmapif_bonus_script_get(fd); break; //Load data
 			case 0x2b2e: next=chmapif_bonus_script_save(fd); break;//Save data
 			default:
@@ -17,6 +17,8 @@ int chmapif_parse_askscdata(int fd);
 int chmapif_parse_getusercount(int fd, int id);
 int chmapif_parse_regmapuser(int fd, int id);
 int chmapif_parse_reqsavechar(int fd, int id);
+void chmapif_save_resync(int fd, uint32 aid, uint32 cid);
+int chmapif_parse_reqsavechar_delta(int fd, int id);
 int chmapif_parse_authok(int fd);
 int chmapif_parse_req_saveskillcooldown(int fd);
 int chmapif_parse_req_skillcooldown(int fd);
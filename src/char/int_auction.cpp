@@ -509,6 +509,7 @@ int inter_auction_parse_frommap(int fd)
 int inter_auction_sql_init(void)
 {
 	auction_db_ = idb_alloc(DB_OPT_RELEASE_DATA);
+	add_timer_func_list(auction_end_timer, "auction_end_timer");
 	inter_auctions_fromsql();
 
 	return 0;
@@ -384,6 +384,8 @@ int main (int argc, char **argv)
 			do_sockets(next);
 		else
 			do_wait(next);
+
+		tick_metrics_commit();
 	}
 
 	do_final();
@@ -87,6 +87,9 @@ typedef struct ers_cache
 	// Objects in-use count
 	unsigned int UsedObjs;
 
+	// Objects the allocated blocks can hold, in use or not
+	unsigned int Allocated;
+
 	// Default = ERS_BLOCK_ENTRIES, can be adjusted for performance for individual cache sizes.
 	unsigned int ChunkSize;
 
@@ -113,6 +116,12 @@ struct ers_instance_t {
 	// Count of objects in use, used for detecting memory leaks
 	unsigned int Count;
 
+	// Highest Count reached since the instance was created
+	unsigned int Peak;
+
+	// Total number of allocations served by this instance
+	uint64 Allocs;
+
 	struct ers_instance_t *Next, *Prev;
 };
 
@@ -139,6 +148,7 @@ static ers_cache_t *ers_find_cache(unsigned int size, enum ERSOptions Options) {
 	cache->Free = 0;
 	cache->Used = 0;
 	cache->UsedObjs = 0;
+	cache->Allocated = 0;
 	cache->Max = 0;
 	cache->ChunkSize = ERS_BLOCK_ENTRIES;
 	cache->Options = (enum ERSOptions)(Options & ERS_CACHE_OPTIONS);
@@ -202,12 +212,16 @@ static void *ers_obj_alloc_entry(ERS *self)
 
 		CREATE(instance->Cache->Blocks[instance->Cache->Used], unsigned char, instance->Cache->ObjectSize * instance->Cache->ChunkSize);
 		instance->Cache->Used++;
+		instance->Cache->Allocated += instance->Cache->ChunkSize;
 
 		instance->Cache->Free = instance->Cache->ChunkSize -1;
 		ret = &instance->Cache->Blocks[instance->Cache->Used - 1][instance->Cache->Free * instance->Cache->ObjectSize + sizeof(struct ers_list)];
 	}
 
 	instance->Count++;
+	instance->Allocs++;
+	if (instance->Count > instance->Peak)
+		instance->Peak = instance->Count;
 	instance->Cache->UsedObjs++;
 
 	return ret;
@@ -325,30 +339,47 @@ ERS *ers_new(uint32 size, const char *name, enum ERSOptions options)
 	}
 
 	instance->Count = 0;
+	instance->Peak = 0;
+	instance->Allocs = 0;
 
 	return &instance->VTable;
 }
 
 void ers_report(void) {
 	ers_cache_t *cache;
-	unsigned int cache_c = 0, blocks_u = 0, blocks_a = 0, memory_b = 0, memory_t = 0;
+	struct ers_instance_t *instance;
+	unsigned int cache_c = 0, blocks_u = 0, blocks_a = 0;
+	uint64 memory_b = 0, memory_t = 0;
 
 	for (cache = CacheList; cache; cache = cache->Next) {
+		// Objects handed out at least once; the ones not in use wait in the reuse list
+		unsigned int carved = cache->Allocated - cache->Free;
+
 		cache_c++;
 		ShowMessage(CL_BOLD"[ERS Cache of size '" CL_NORMAL "" CL_WHITE "%u" CL_NORMAL "" CL_BOLD "' report]\n" CL_NORMAL, cache->ObjectSize);
 		ShowMessage("\tinstances          : %u\n", cache->ReferenceCount);
-		ShowMessage("\tblocks in use      : %u/%u\n", cache->UsedObjs, cache->UsedObjs+cache->Free);
-		ShowMessage("\tblocks unused      : %u\n", cache->Free);
-		ShowMessage("\tmemory in use      : %.2f MB\n", cache->UsedObjs == 0 ? 0. : (double)((cache->UsedObjs * cache->ObjectSize)/1024)/1024);
-		ShowMessage("\tmemory allocated   : %.2f MB\n", (cache->Free+cache->UsedObjs) == 0 ? 0. : (double)(((cache->UsedObjs+cache->Free) * cache->ObjectSize)/1024)/1024);
+		ShowMessage("\tblocks in use      : %u/%u\n", cache->UsedObjs, cache->Allocated);
+		ShowMessage("\tblocks unused      : %u (%u reusable)\n", cache->Allocated - cache->UsedObjs, carved - cache->UsedObjs);
+		ShowMessage("\tmemory in use      : %.2f MB\n", (double)((uint64)cache->UsedObjs * cache->ObjectSize) / 1024 / 1024);
+		ShowMessage("\tmemory allocated   : %.2f MB\n", (double)((uint64)cache->Allocated * cache->ObjectSize) / 1024 / 1024);
 		blocks_u += cache->UsedObjs;
-		blocks_a += cache->UsedObjs + cache->Free;
-		memory_b += cache->UsedObjs * cache->ObjectSize;
-		memory_t += (cache->UsedObjs+cache->Free) * cache->ObjectSize;
+		blocks_a += cache->Allocated;
+		memory_b += (uint64)cache->UsedObjs * cache->ObjectSize;
+		memory_t += (uint64)cache->Allocated * cache->ObjectSize;
+	}
+
+	for (instance = InstanceList; instance; instance = instance->Next) {
+		// Instances sharing a cache are still reported apart, so the live bytes can be traced back to a type
+		ShowMessage(CL_BOLD"[ERS Instance '" CL_NORMAL "" CL_WHITE "%s" CL_NORMAL "" CL_BOLD "' report]\n" CL_NORMAL, instance->Name);
+		ShowMessage("\tentry size         : %u\n", instance->Cache->ObjectSize);
+		ShowMessage("\tentries in use     : %u (peak %u)\n", instance->Count, instance->Peak);
+		ShowMessage("\tmemory in use      : %.2f KB\n", (double)((uint64)instance->Count * instance->Cache->ObjectSize) / 1024);
+		ShowMessage("\ttotal allocations  : %" PRIu64 "\n", instance->Allocs);
 	}
+
 	ShowInfo("ers_report: '" CL_WHITE "%u" CL_NORMAL "' caches in use\n",cache_c);
-	ShowInfo("ers_report: '" CL_WHITE "%u" CL_NORMAL "' blocks in use, consuming '" CL_WHITE "%.2f MB" CL_NORMAL "'\n",blocks_u,(double)((memory_b)/1024)/1024);
-	ShowInfo("ers_report: '" CL_WHITE "%u" CL_NORMAL "' blocks total, consuming '" CL_WHITE "%.2f MB" CL_NORMAL "' \n",blocks_a,(double)((memory_t)/1024)/1024);
+	ShowInfo("ers_report: '" CL_WHITE "%u" CL_NORMAL "' blocks in use, consuming '" CL_WHITE "%.2f MB" CL_NORMAL "'\n",blocks_u,(double)memory_b/1024/1024);
+	ShowInfo("ers_report: '" CL_WHITE "%u" CL_NORMAL "' blocks total, consuming '" CL_WHITE "%.2f MB" CL_NORMAL "' \n",blocks_a,(double)memory_t/1024/1024);
 }
 
 /**
@@ -158,6 +158,7 @@ const t_itemid WEDDING_RING_F = 2635;
 #define MAX_FRIENDS 40
 #define MAX_MEMOPOINTS 3
 #define MAX_SKILLCOOLDOWN 20
+#define CHARSAVE_DELTA_BLOCK 32 ///< Granularity in bytes of the mmo_charstatus delta saves between map- and char-server
 
 //Size of the fame list arrays.
 #define MAX_FAME_LIST 10
@@ -7,6 +7,7 @@
 #include "cbasetypes.hpp"
 
 void rnd_init(void);
+void rnd_seed(uint32 seed);
 
 int32 rnd(void);// [0, SINT32_MAX]
 int32 rnd_value(int32 min, int32 max);// [min, max]
@@ -15,6 +15,7 @@
 	#include <sys/ioctl.h>
 	#include <sys/socket.h>
 	#include <sys/time.h>
+	#include <sys/uio.h>
 	#include <unistd.h>
 
 	#if defined(__linux__) || defined(__linux)
@@ -40,8 +41,10 @@
 	#endif
 #endif
 
+#include <algorithm>
 #include <chrono>
 #include <thread>
+#include <vector>
 
 #include "cbasetypes.hpp"
 #include "malloc.hpp"
@@ -218,6 +221,35 @@ char* sErr(int code)
 	#define MSG_NOSIGNAL 0
 #endif
 
+#ifdef WIN32
+typedef WSABUF s_socket_iovec;
+#define sIovecSet(iov,buffer,length) ( (iov).buf = (char *)(buffer), (iov).len = (ULONG)(length) )
+#else
+typedef struct iovec s_socket_iovec;
+#define sIovecSet(iov,buffer,length) ( (iov).iov_base = (buffer), (iov).iov_len = (length) )
+#endif
+
+/// Sends several buffers with a single call.
+/// @return Number of bytes sent or SOCKET_ERROR
+static int sSendv(int fd, s_socket_iovec* iov, int count)
+{
+#ifdef WIN32
+	DWORD sent = 0;
+
+	if( WSASend(fd2sock(fd), iov, count, &sent, 0, NULL, NULL) == SOCKET_ERROR )
+		return SOCKET_ERROR;
+
+	return (int)sent;
+#else
+	struct msghdr msg = {};
+
+	msg.msg_iov = iov;
+	msg.msg_iovlen = count;
+
+	return (int)sendmsg(fd, &msg, MSG_NOSIGNAL);
+#endif
+}
+
 #ifndef SOCKET_EPOLL
 	// Select based Event Dispatcher
 	fd_set readfds;
@@ -251,11 +283,23 @@ static size_t socket_data_o = 0, socket_data_co = 0, socket_data_qo = 0;
 static time_t socket_data_last_tick = 0;
 #endif
 
+// Per-opcode packet metrics, only collected while enabled
+bool packet_metrics = false;
+static PacketLenFunc packet_metrics_len_func = nullptr;
+static void packet_metrics_add_write(const uint8* data, size_t len);
+static std::vector<s_packet_metric> packet_metric_data[PACKET_METRIC_MAX];
+
 // initial recv buffer size (this will also be the max. size)
 // biggest known packet: S 0153 <len>.w <emblem data>.?B -> 24x24 256 color .bmp (0153 + len.w + 1618/1654/1756 bytes)
 #define RFIFO_SIZE (2*1024)
-// initial send buffer size (will be resized as needed)
+// free space kept in the active write segment after every packet
 #define WFIFO_SIZE (16*1024)
+// capacity of the pooled write segments (server links use bigger ones, see realloc_fifo)
+#define WFIFO_SEGMENT_SIZE (2*WFIFO_SIZE)
+// maximum number of unused write segments kept for reuse
+#define WFIFO_POOL_MAX 256
+// maximum number of segments handed to a single send call
+#define WFIFO_IOV_MAX 16
 
 // Maximum size of pending data in the write fifo. (for non-server connections)
 // The connection is closed if it goes over the limit.
@@ -263,6 +307,9 @@ static time_t socket_data_last_tick = 0;
 
 struct socket_data* session[MAXCONN];
 
+// Unused write segments of WFIFO_SEGMENT_SIZE bytes
+static std::vector<struct socket_wsegment*> wfifo_pool;
+
 #ifdef SEND_SHORTLIST
 int send_shortlist_array[MAXCONN];// we only support MAXCONN sockets, limit the array to that
 size_t send_shortlist_count = 0;// how many fd's are in the shortlist
@@ -404,26 +451,169 @@ int recv_to_fifo(int fd)
 	return 0;
 }
 
+/// Takes a write segment that can hold at least size bytes, reusing a pooled one when possible.
+static struct socket_wsegment* wfifo_segment_alloc(size_t size)
+{
+	struct socket_wsegment* seg;
+
+	if( size <= WFIFO_SEGMENT_SIZE && !wfifo_pool.empty() ) {
+		seg = wfifo_pool.back();
+		wfifo_pool.pop_back();
+	} else {
+		size = std::max<size_t>(size, WFIFO_SEGMENT_SIZE);
+		seg = (struct socket_wsegment*)aMalloc(sizeof(struct socket_wsegment) + size);
+		seg->max = size;
+		seg->data = (uint8*)(seg + 1);
+	}
+
+	seg->next = NULL;
+	seg->len = 0;
+	seg->pos = 0;
+
+	return seg;
+}
+
+/// Returns a write segment to the pool, or frees it if it has an odd size or the pool is full.
+static void wfifo_segment_free(struct socket_wsegment* seg)
+{
+	if( seg->max == WFIFO_SEGMENT_SIZE && wfifo_pool.size() < WFIFO_POOL_MAX )
+		wfifo_pool.push_back(seg);
+	else
+		aFree(seg);
+}
+
+/// Makes a new segment of at least size bytes the active write segment of the session.
+static void wfifo_activate(struct socket_data* s, size_t size)
+{
+	s->wseg = wfifo_segment_alloc(std::max(s->wseg_size, size));
+	s->wdata = s->wseg->data;
+	s->max_wdata = s->wseg->max;
+	s->wdata_size = 0;
+	s->wdata_pos = 0;
+}
+
+/// Releases the active write segment of the session, it must not hold unsent data.
+static void wfifo_deactivate(struct socket_data* s)
+{
+	if( s->wseg != NULL )
+		wfifo_segment_free(s->wseg);
+
+	s->wseg = NULL;
+	s->wdata = NULL;
+	s->max_wdata = 0;
+	s->wdata_size = 0;
+	s->wdata_pos = 0;
+}
+
+/// Queues the unsent part of the active write segment for sending and leaves the session without one.
+static void wfifo_seal(struct socket_data* s)
+{
+	struct socket_wsegment* seg = s->wseg;
+
+	seg->next = NULL;
+	seg->len = s->wdata_size;
+	seg->pos = s->wdata_pos;
+
+	if( s->wqueue_tail != NULL )
+		s->wqueue_tail->next = seg;
+	else
+		s->wqueue = seg;
+	s->wqueue_tail = seg;
+	s->wqueue_size += seg->len - seg->pos;
+
+	s->wseg = NULL;
+	s->wdata = NULL;
+	s->max_wdata = 0;
+	s->wdata_size = 0;
+	s->wdata_pos = 0;
+}
+
+/// Drops all data waiting to be sent.
+static void wfifo_drop(struct socket_data* s)
+{
+	while( s->wqueue != NULL ) {
+		struct socket_wsegment* next = s->wqueue->next;
+
+		wfifo_segment_free(s->wqueue);
+		s->wqueue = next;
+	}
+
+	s->wqueue_tail = NULL;
+	s->wqueue_size = 0;
+	s->wdata_size = 0;
+	s->wdata_pos = 0;
+}
+
+/// Marks len bytes as sent, releasing the segments that were sent completely.
+static void wfifo_consume(struct socket_data* s, size_t len)
+{
+	while( len > 0 && s->wqueue != NULL ) {
+		struct socket_wsegment* seg = s->wqueue;
+		size_t sent = std::min(len, seg->len - seg->pos);
+
+		seg->pos += sent;
+		s->wqueue_size -= sent;
+		len -= sent;
+
+		if( seg->pos == seg->len ) {
+			s->wqueue = seg->next;
+			if( s->wqueue == NULL )
+				s->wqueue_tail = NULL;
+			wfifo_segment_free(seg);
+		}
+	}
+
+	s->wdata_pos += len;
+
+	if( s->wqueue == NULL && s->wdata_pos == s->wdata_size ) {
+		if( s->flag.server ) {
+			s->wdata_size = 0;
+			s->wdata_pos = 0;
+		} else // idle client sessions hand their segment back to the pool, WFIFOP takes a new one
+			wfifo_deactivate(s);
+	}
+}
+
+/// Gives a session that released its idle write segment a new one.
+/// @see WFIFOP
+uint8* wfifo_acquire(int fd)
+{
+	wfifo_activate(session[fd], 0);
+
+	return session[fd]->wdata;
+}
+
 int send_from_fifo(int fd)
 {
-	int len;
+	struct socket_data* s;
+	struct socket_wsegment* seg;
+	s_socket_iovec iov[WFIFO_IOV_MAX];
+	int count = 0, len;
 
 	if( !session_isValid(fd) )
 		return -1;
 
-	if( session[fd]->wdata_size == 0 )
+	if( WFIFOPENDING(fd) == 0 )
 		return 0; // nothing to send
 
-	len = sSend(fd, (const char *) session[fd]->wdata, (int)session[fd]->wdata_size, MSG_NOSIGNAL);
+	s = session[fd];
+
+	// queued segments go first, the active one holds the most recent packets
+	for( seg = s->wqueue; seg != NULL && count < WFIFO_IOV_MAX; seg = seg->next )
+		sIovecSet(iov[count++], seg->data + seg->pos, seg->len - seg->pos);
+	if( count < WFIFO_IOV_MAX && s->wdata_size > s->wdata_pos )
+		sIovecSet(iov[count++], s->wdata + s->wdata_pos, s->wdata_size - s->wdata_pos);
+
+	len = sSendv(fd, iov, count);
 
 	if( len == SOCKET_ERROR )
 	{//An exception has occured
 		if( sErrno != S_EWOULDBLOCK ) {
 			//ShowDebug("send_from_fifo: %s, ending connection #%d\n", error_msg(), fd);
 #ifdef SHOW_SERVER_STATS
-			socket_data_qo -= session[fd]->wdata_size;
+			socket_data_qo -= WFIFOPENDING(fd);
 #endif
-			session[fd]->wdata_size = 0; //Clear the send queue as we can't send anymore. [Skotlex]
+			wfifo_drop(s); //Clear the send queue as we can't send anymore. [Skotlex]
 			set_eof(fd);
 		}
 		return 0;
@@ -431,14 +621,9 @@ int send_from_fifo(int fd)
 
 	if( len > 0 )
 	{
-		session[fd]->wdata_tick = last_tick;
+		s->wdata_tick = last_tick;
 
-		// some data could not be transferred?
-		// shift unsent data to the beginning of the queue
-		if( (size_t)len < session[fd]->wdata_size )
-			memmove(session[fd]->wdata, session[fd]->wdata + len, session[fd]->wdata_size - len);
-
-		session[fd]->wdata_size -= len;
+		wfifo_consume(s, len);
 #ifdef SHOW_SERVER_STATS
 		socket_data_o += len;
 		socket_data_qo -= len;
@@ -726,9 +911,9 @@ static int create_session(int fd, RecvFunc func_recv, SendFunc func_send, ParseF
 {
 	CREATE(session[fd], struct socket_data, 1);
 	CREATE(session[fd]->rdata, unsigned char, RFIFO_SIZE);
-	CREATE(session[fd]->wdata, unsigned char, WFIFO_SIZE);
 	session[fd]->max_rdata  = RFIFO_SIZE;
-	session[fd]->max_wdata  = WFIFO_SIZE;
+	session[fd]->wseg_size  = WFIFO_SEGMENT_SIZE;
+	wfifo_activate(session[fd], 0);
 	session[fd]->func_recv  = func_recv;
 	session[fd]->func_send  = func_send;
 	session[fd]->func_parse = func_parse;
@@ -743,10 +928,11 @@ static void delete_session(int fd)
 	{
 #ifdef SHOW_SERVER_STATS
 		socket_data_qi -= session[fd]->rdata_size - session[fd]->rdata_pos;
-		socket_data_qo -= session[fd]->wdata_size;
+		socket_data_qo -= WFIFOPENDING(fd);
 #endif
 		aFree(session[fd]->rdata);
-		aFree(session[fd]->wdata);
+		wfifo_drop(session[fd]);
+		wfifo_deactivate(session[fd]);
 		aFree(session[fd]->session_data);
 		aFree(session[fd]);
 		session[fd] = NULL;
@@ -763,36 +949,36 @@ int realloc_fifo(int fd, unsigned int rfifo_size, unsigned int wfifo_size)
 		session[fd]->max_rdata  = rfifo_size;
 	}
 
-	if( session[fd]->max_wdata != wfifo_size && session[fd]->wdata_size < wfifo_size) {
-		RECREATE(session[fd]->wdata, unsigned char, wfifo_size);
-		session[fd]->max_wdata  = wfifo_size;
+	if( session[fd]->wseg_size != wfifo_size ) {
+		session[fd]->wseg_size = wfifo_size;
+		// switch right away unless the active segment still has data to send, queued data is never moved
+		if( session[fd]->wdata_size == session[fd]->wdata_pos ) {
+			wfifo_deactivate(session[fd]);
+			wfifo_activate(session[fd], 0);
+		}
 	}
 	return 0;
 }
 
 int realloc_writefifo(int fd, size_t addition)
 {
-	size_t newsize;
+	struct socket_data* s;
 
 	if( !session_isValid(fd) ) // might not happen
 		return 0;
 
-	if( session[fd]->wdata_size + addition  > session[fd]->max_wdata )
-	{	// grow rule; grow in multiples of WFIFO_SIZE
-		newsize = WFIFO_SIZE;
-		while( session[fd]->wdata_size + addition > newsize ) newsize += WFIFO_SIZE;
-	}
-	else
-	if( session[fd]->max_wdata >= (size_t)2*(session[fd]->flag.server?FIFOSIZE_SERVERLINK:WFIFO_SIZE)
-		&& (session[fd]->wdata_size+addition)*4 < session[fd]->max_wdata )
-	{	// shrink rule, shrink by 2 when only a quarter of the fifo is used, don't shrink below nominal size.
-		newsize = session[fd]->max_wdata / 2;
-	}
-	else // no change
+	s = session[fd];
+
+	if( s->wdata != NULL && s->wdata_size + addition <= s->max_wdata )
 		return 0;
 
-	RECREATE(session[fd]->wdata, unsigned char, newsize);
-	session[fd]->max_wdata  = newsize;
+	// instead of growing the buffer, queue the filled segment as it is and continue in a new one
+	if( s->wdata_size > s->wdata_pos )
+		wfifo_seal(s);
+	else
+		wfifo_deactivate(s);
+
+	wfifo_activate(s, addition);
 
 	return 0;
 }
@@ -861,26 +1047,29 @@ int WFIFOSET(int fd, size_t len)
 			return 0;
 		}
 
-		if( s->wdata_size+len > WFIFO_MAX ) {// reached maximum write fifo size
+		if( WFIFOPENDING(fd)+len > WFIFO_MAX ) {// reached maximum write fifo size
 			ShowError("WFIFOSET: Maximum write buffer size for client connection %d exceeded, most likely caused by packet 0x%04x (len=%" PRIuPTR ", ip=%lu.%lu.%lu.%lu).\n", fd, WFIFOW(fd,0), len, CONVIP(s->client_addr));
 			set_eof(fd);
 			return 0;
 		}
 
 	}
+	if( packet_metrics && !s->flag.server )
+		packet_metrics_add_write(WFIFOP(fd,0), len);
+
 	s->wdata_size += len;
 #ifdef SHOW_SERVER_STATS
 	socket_data_qo += len;
 #endif
 	//If the interserver has 200% of its normal size full, flush the data.
-	if( s->flag.server && s->wdata_size >= 2*FIFOSIZE_SERVERLINK )
+	if( s->flag.server && WFIFOPENDING(fd) >= 2*FIFOSIZE_SERVERLINK )
 		flush_fifo(fd);
 
-	// always keep a WFIFO_SIZE reserve in the buffer
+	// always keep a WFIFO_SIZE reserve in the active segment
 	// For inter-server connections, let the reserve be 1/4th of the link size.
 	newreserve = s->flag.server ? FIFOSIZE_SERVERLINK / 4 : WFIFO_SIZE;
 
-	// readjust the buffer to include the chosen reserve
+	// move on to a new segment if the reserve does not fit anymore
 	realloc_writefifo(fd, newreserve);
 
 #ifdef SEND_SHORTLIST
@@ -905,6 +1094,7 @@ int do_sockets(t_tick next)
 	struct timeval timeout;
 #endif
 	int ret,i;
+	uint64 start = tick_metrics ? tick_metrics_clock() : 0, now;
 
 	// PRESEND Timers are executed before do_sendrecv and can send packets and/or set sessions to eof.
 	// Send remaining data and process client-side disconnects here.
@@ -916,11 +1106,14 @@ int do_sockets(t_tick next)
 		if(!session[i])
 			continue;
 
-		if(session[i]->wdata_size)
+		if(WFIFOPENDING(i))
 			session[i]->func_send(i);
 	}
 #endif
 
+	if( start != 0 )
+		tick_metrics_add(TICK_PHASE_SEND, tick_metrics_clock() - start);
+
 #ifndef SOCKET_EPOLL
 	// Select based Event Dispatcher
 
@@ -957,6 +1150,9 @@ int do_sockets(t_tick next)
 
 	last_tick = time(NULL);
 
+	// the wait above is idle time, it is not accounted to any phase
+	start = tick_metrics ? tick_metrics_clock() : 0;
+
 #if defined(WIN32)
 	// on windows, enumerating all members of the fd_set is way faster if we access the internals
 	for( i = 0; i < (int)rfd.fd_count; ++i )
@@ -997,6 +1193,12 @@ int do_sockets(t_tick next)
 	}
 #endif
 
+	if( start != 0 ){
+		now = tick_metrics_clock();
+		tick_metrics_add(TICK_PHASE_RECV, now - start);
+		start = now;
+	}
+
 	// POSTSEND Send remaining data and handle eof sessions.
 #ifdef SEND_SHORTLIST
 	send_shortlist_do_sends();
@@ -1006,7 +1208,7 @@ int do_sockets(t_tick next)
 		if(!session[i])
 			continue;
 
-		if(session[i]->wdata_size)
+		if(WFIFOPENDING(i))
 			session[i]->func_send(i);
 
 		if(session[i]->flag.eof) //func_send can't free a session, this is safe.
@@ -1016,6 +1218,12 @@ int do_sockets(t_tick next)
 	}
 #endif
 
+	if( start != 0 ){
+		now = tick_metrics_clock();
+		tick_metrics_add(TICK_PHASE_SEND, now - start);
+		start = now;
+	}
+
 	// parse input data on each socket
 	for(i = 1; i < fd_max; i++)
 	{
@@ -1032,6 +1240,10 @@ int do_sockets(t_tick next)
 			}
 		}
 
+		// idle clients have nothing to parse, only server links run their parse function every loop (pings)
+		if( !session[i]->flag.server && !session[i]->flag.eof && RFIFOREST(i) == 0 )
+			continue;
+
 		session[i]->func_parse(i);
 
 		if(!session[i])
@@ -1045,6 +1257,9 @@ int do_sockets(t_tick next)
 		RFIFOFLUSH(i);
 	}
 
+	if( start != 0 )
+		tick_metrics_add(TICK_PHASE_PARSE, tick_metrics_clock() - start);
+
 #ifdef SHOW_SERVER_STATS
 	if (last_tick != socket_data_last_tick)
 	{
@@ -1379,6 +1594,120 @@ int socket_config_read(const char* cfgName)
 }
 
 
+/// Enable or disable the per-opcode packet metrics.
+/// The counters are allocated on first use and kept until they are reset.
+void packet_metrics_enable(bool enable)
+{
+	if( enable ){
+		for( int i = 0; i < PACKET_METRIC_MAX; i++ ){
+			if( packet_metric_data[i].empty() )
+				packet_metric_data[i].resize(0x10000);
+		}
+	}
+
+	packet_metrics = enable;
+}
+
+/// Account a packet to the metrics of its opcode.
+/// @param dir: Direction of the packet
+/// @param cmd: Packet id
+/// @param len: Packet length
+/// @param time_ns: Time spent processing the packet
+void packet_metrics_add(enum e_packet_metric_dir dir, uint16 cmd, size_t len, uint64 time_ns)
+{
+	if( !packet_metrics )
+		return;
+
+	s_packet_metric& metric = packet_metric_data[dir][cmd];
+
+	metric.count++;
+	metric.bytes += len;
+	metric.time_ns += time_ns;
+}
+
+/// Set the function used to split the outbound writes that hold several packets.
+/// @param func: Returns the length of a packet id, -1 if it has a variable length or 0 if unknown
+void packet_metrics_set_lenfunc(PacketLenFunc func)
+{
+	packet_metrics_len_func = func;
+}
+
+/// Account the packets of a WFIFOSET to their opcodes.
+/// A single write may hold several packets, whatever can't be split is accounted to the opcode it starts with.
+/// @param data: Start of the write
+/// @param len: Length of the write
+static void packet_metrics_add_write(const uint8* data, size_t len)
+{
+	size_t pos = 0;
+
+	while( len - pos >= 2 ){
+		uint16 cmd = RBUFW(data, pos);
+		int packet_len = ( packet_metrics_len_func != nullptr ) ? packet_metrics_len_func(cmd) : 0;
+
+		if( packet_len == -1 && len - pos >= 4 )
+			packet_len = RBUFW(data, pos + 2);
+		if( packet_len < 2 || (size_t)packet_len > len - pos )
+			packet_len = (int)( len - pos );
+
+		packet_metrics_add(PACKET_METRIC_OUT, cmd, packet_len, 0);
+		pos += packet_len;
+	}
+}
+
+/// Clear all collected packet metrics.
+void packet_metrics_reset(void)
+{
+	for( int i = 0; i < PACKET_METRIC_MAX; i++ ){
+		for( s_packet_metric& metric : packet_metric_data[i] )
+			metric = {};
+	}
+}
+
+/// Display the collected packet metrics.
+/// Inbound packets are sorted by handler time, outbound packets by bytes.
+/// @param limit: Maximum amount of opcodes shown per direction, 0 for all
+void packet_metrics_report(size_t limit)
+{
+	static const char* names[PACKET_METRIC_MAX] = { "Inbound", "Outbound" };
+
+	for( int i = 0; i < PACKET_METRIC_MAX; i++ ){
+		std::vector<uint16> cmds;
+		uint64 count = 0, bytes = 0, time_ns = 0;
+
+		for( size_t cmd = 0; cmd < packet_metric_data[i].size(); cmd++ ){
+			const s_packet_metric& metric = packet_metric_data[i][cmd];
+
+			if( metric.count == 0 )
+				continue;
+
+			cmds.push_back((uint16)cmd);
+			count += metric.count;
+			bytes += metric.bytes;
+			time_ns += metric.time_ns;
+		}
+
+		std::sort(cmds.begin(), cmds.end(), [i]( uint16 a, uint16 b ){
+			const s_packet_metric& ma = packet_metric_data[i][a];
+			const s_packet_metric& mb = packet_metric_data[i][b];
+
+			if( i == PACKET_METRIC_IN && ma.time_ns != mb.time_ns )
+				return ma.time_ns > mb.time_ns;
+			return ma.bytes > mb.bytes;
+		});
+
+		ShowInfo("%s packets: %" PRIu64 " packets, %" PRIu64 " bytes, %.3f ms handler time, %" PRIuPTR " opcodes.\n", names[i], count, bytes, time_ns / 1000000., cmds.size());
+
+		for( size_t n = 0; n < cmds.size() && (limit == 0 || n < limit); n++ ){
+			const s_packet_metric& metric = packet_metric_data[i][cmds[n]];
+
+			if( i == PACKET_METRIC_IN )
+				ShowInfo("  0x%04x: %10" PRIu64 " packets, %12" PRIu64 " bytes, %10.3f ms total, %8.0f ns/packet\n", cmds[n], metric.count, metric.bytes, metric.time_ns / 1000000., (double)metric.time_ns / metric.count);
+			else
+				ShowInfo("  0x%04x: %10" PRIu64 " packets, %12" PRIu64 " bytes\n", cmds[n], metric.count, metric.bytes);
+		}
+	}
+}
+
 void socket_final(void)
 {
 	int i;
@@ -1406,11 +1735,16 @@ void socket_final(void)
 
 	// session[0]
 	aFree(session[0]->rdata);
-	aFree(session[0]->wdata);
+	wfifo_drop(session[0]);
+	wfifo_deactivate(session[0]);
 	aFree(session[0]->session_data);
 	aFree(session[0]);
 	session[0] = NULL;
 
+	for( struct socket_wsegment* seg : wfifo_pool )
+		aFree(seg);
+	wfifo_pool.clear();
+
 #ifdef WIN32
 	// Shut down windows networking
 	if( WSACleanup() != 0 ){
@@ -1734,7 +2068,7 @@ void send_shortlist_do_sends()
 		if( session[fd] )
 		{
 			// Send data
-			if( session[fd]->wdata_size )
+			if( WFIFOPENDING(fd) )
 				session[fd]->func_send(fd);
 
 			// If it's been marked as eof, call the parse func on it so that
@@ -1744,7 +2078,7 @@ void send_shortlist_do_sends()
 
 			// If the session still exists, is not eof and has things left to
 			// be sent from it we'll re-add it to the shortlist.
-			if( session_isActive(fd) && session[fd]->wdata_size )
+			if( session_isActive(fd) && WFIFOPENDING(fd) )
 				send_shortlist_add_fd(fd);
 		}
 	}
@@ -29,7 +29,7 @@
 #define RFIFOHEAD(fd)
 #define WFIFOHEAD(fd, size) do{ if((fd) && session[fd]->wdata_size + (size) > session[fd]->max_wdata ) realloc_writefifo(fd, size); }while(0)
 #define RFIFOP(fd,pos) (session[fd]->rdata + session[fd]->rdata_pos + (pos))
-#define WFIFOP(fd,pos) (session[fd]->wdata + session[fd]->wdata_size + (pos))
+#define WFIFOP(fd,pos) ((session[fd]->wdata != nullptr ? session[fd]->wdata : wfifo_acquire(fd)) + session[fd]->wdata_size + (pos))
 
 #define RFIFOCP(fd,pos) ((char*)RFIFOP(fd,pos))
 #define WFIFOCP(fd,pos) ((char*)WFIFOP(fd,pos))
@@ -45,6 +45,7 @@
 #define WFIFOQ(fd,pos) (*(uint64*)WFIFOP(fd,pos))
 #define RFIFOSPACE(fd) (session[fd]->max_rdata - session[fd]->rdata_size)
 #define WFIFOSPACE(fd) (session[fd]->max_wdata - session[fd]->wdata_size)
+#define WFIFOPENDING(fd) (session[fd]->wqueue_size + session[fd]->wdata_size - session[fd]->wdata_pos)
 
 #define RFIFOREST(fd)  (session[fd]->flag.eof ? 0 : session[fd]->rdata_size - session[fd]->rdata_pos)
 #define RFIFOFLUSH(fd) \
@@ -83,6 +84,17 @@ typedef int (*RecvFunc)(int fd);
 typedef int (*SendFunc)(int fd);
 typedef int (*ParseFunc)(int fd);
 
+/// Fixed-size piece of a write fifo.
+/// Packets are written into the session's active segment; once it runs out of space it is queued
+/// for sending as it is and a new one is taken, so queued data is never moved or reallocated.
+struct socket_wsegment {
+	struct socket_wsegment *next;
+	size_t max; // capacity of data
+	size_t len; // bytes written
+	size_t pos; // bytes already sent
+	uint8 *data;
+};
+
 struct socket_data
 {
 	struct {
@@ -97,6 +109,11 @@ struct socket_data
 	size_t max_rdata, max_wdata;
 	size_t rdata_size, wdata_size;
 	size_t rdata_pos;
+	size_t wdata_pos; // bytes of wdata that were already sent
+	struct socket_wsegment *wseg; // segment wdata belongs to, packets are written into it
+	struct socket_wsegment *wqueue, *wqueue_tail; // filled segments waiting to be sent, oldest first
+	size_t wqueue_size; // bytes in wqueue that were not sent yet
+	size_t wseg_size; // capacity of new write segments
 	time_t rdata_tick; // time of last recv (for detecting timeouts); zero when timeout is disabled
 	time_t wdata_tick; // time of last send (for detecting timeouts);
 
@@ -129,6 +146,7 @@ int make_listen_bind(uint32 ip, uint16 port);
 int make_connection(uint32 ip, uint16 port, bool silent, int timeout);
 int realloc_fifo(int fd, unsigned int rfifo_size, unsigned int wfifo_size);
 int realloc_writefifo(int fd, size_t addition);
+uint8 *wfifo_acquire(int fd);
 int WFIFOSET(int fd, size_t len);
 int RFIFOSKIP(int fd, size_t len);
 
@@ -144,6 +162,29 @@ extern void set_nonblocking(int fd, unsigned long yes);
 
 void set_defaultparse(ParseFunc defaultparse);
 
+/// Per-opcode packet metrics
+enum e_packet_metric_dir : uint8 {
+	PACKET_METRIC_IN = 0, ///< Received packets, timed by the parse function
+	PACKET_METRIC_OUT, ///< Packets sent to clients through WFIFOSET
+	PACKET_METRIC_MAX
+};
+
+struct s_packet_metric {
+	uint64 count;
+	uint64 bytes;
+	uint64 time_ns;
+};
+
+typedef int (*PacketLenFunc)(uint16 cmd);
+
+extern bool packet_metrics;
+
+void packet_metrics_enable(bool enable);
+void packet_metrics_add(enum e_packet_metric_dir dir, uint16 cmd, size_t len, uint64 time_ns);
+void packet_metrics_set_lenfunc(PacketLenFunc func);
+void packet_metrics_reset(void);
+void packet_metrics_report(size_t limit);
+
 
 /// Server operation request
 enum chrif_req_op {
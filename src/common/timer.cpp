@@ -3,9 +3,15 @@
 
 #include "timer.hpp"
 
+#include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
 
+#include <algorithm>
+#include <chrono>
+#include <unordered_map>
+#include <vector>
+
 #ifdef WIN32
 #include "winapi.hpp" // GetTickCount()
 #else
@@ -16,6 +22,7 @@
 #include "malloc.hpp"
 #include "nullpo.hpp"
 #include "showmsg.hpp"
+#include "strlib.hpp"
 #include "utils.hpp"
 
 // If the server can't handle processing thousands of monsters
@@ -95,6 +102,334 @@ const char* search_timer_func_list(TimerFunc func)
 	return "unknown timer function";
 }
 
+/*----------------------------
+ * 	Tick metrics
+ *----------------------------*/
+
+// Number of main loop iterations kept for the slow tick dump
+#define TICK_METRIC_HISTORY 16
+// Log-linear histogram buckets, 4 per power of two microseconds
+#define TICK_HISTOGRAM_BUCKETS 128
+
+struct s_tick_histogram {
+	uint64 buckets[TICK_HISTOGRAM_BUCKETS];
+	uint64 count;
+	uint64 time_ns;
+	uint64 max_ns;
+};
+
+struct s_timer_metric {
+	uint64 count;
+	uint64 time_ns;
+	uint64 max_ns;
+};
+
+/// Breakdown of one main loop iteration
+struct s_tick_record {
+	t_tick tick;
+	uint64 phase_ns[TICK_PHASE_MAX];
+	TimerFunc slowest_func; ///< Slowest timer callback of the iteration
+	uint64 slowest_ns;
+};
+
+static const char* tick_phase_names[TICK_PHASE_MAX] = { "timer", "recv", "parse", "send" };
+
+bool tick_metrics = false;
+static std::unordered_map<TimerFunc, s_timer_metric> tick_metrics_timers;
+static s_tick_histogram tick_metrics_histograms[TICK_PHASE_MAX + 1]; // the last one holds whole iterations
+static s_tick_record tick_metrics_history[TICK_METRIC_HISTORY];
+static size_t tick_metrics_history_count = 0;
+static s_tick_record tick_metrics_current;
+static t_tick tick_metrics_slow = 0; // iterations taking at least this many ms dump the history, 0 to disable
+static t_tick tick_metrics_last_dump = 0;
+
+/// Monotonic clock used by the tick metrics, in nanoseconds.
+uint64 tick_metrics_clock(void)
+{
+	return std::chrono::duration_cast<std::chrono::nanoseconds>( std::chrono::steady_clock::now().time_since_epoch() ).count();
+}
+
+/// Histogram bucket of a duration: exact up to 4us, then 4 buckets per power of two.
+static size_t tick_histogram_bucket(uint64 time_ns)
+{
+	uint64 us = time_ns / 1000;
+	size_t log = 2;
+
+	if( us < 4 )
+		return (size_t)us;
+
+	while( (us >> (log + 1)) != 0 )
+		log++;
+
+	return std::min<size_t>( (log - 1) * 4 + (size_t)((us >> (log - 2)) & 3), TICK_HISTOGRAM_BUCKETS - 1 );
+}
+
+/// Smallest duration of a histogram bucket, in microseconds.
+static uint64 tick_histogram_floor(size_t bucket)
+{
+	if( bucket < 4 )
+		return bucket;
+
+	return (uint64)(4 + bucket % 4) << (bucket / 4 - 1);
+}
+
+static void tick_histogram_add(s_tick_histogram& histogram, uint64 time_ns)
+{
+	histogram.buckets[tick_histogram_bucket(time_ns)]++;
+	histogram.count++;
+	histogram.time_ns += time_ns;
+	histogram.max_ns = std::max(histogram.max_ns, time_ns);
+}
+
+/// Duration below which the given fraction of the samples lie, in milliseconds.
+/// Precision is that of the bucket, about 25%.
+static double tick_histogram_percentile(const s_tick_histogram& histogram, double fraction)
+{
+	uint64 rank = (uint64)(histogram.count * fraction), seen = 0;
+
+	for( size_t i = 0; i < TICK_HISTOGRAM_BUCKETS; i++ ){
+		seen += histogram.buckets[i];
+
+		if( seen > rank )
+			return tick_histogram_floor(i + 1) / 1000.;
+	}
+
+	return histogram.max_ns / 1000000.;
+}
+
+/// Account a timer callback to its function and to the timer phase.
+static void tick_metrics_timer(TimerFunc func, uint64 time_ns)
+{
+	s_timer_metric& metric = tick_metrics_timers[func];
+
+	metric.count++;
+	metric.time_ns += time_ns;
+	metric.max_ns = std::max(metric.max_ns, time_ns);
+
+	tick_metrics_current.phase_ns[TICK_PHASE_TIMER] += time_ns;
+
+	if( time_ns > tick_metrics_current.slowest_ns ){
+		tick_metrics_current.slowest_func = func;
+		tick_metrics_current.slowest_ns = time_ns;
+	}
+}
+
+/// Account time spent in a main loop phase to the current iteration.
+/// @param phase: Phase of the main loop
+/// @param time_ns: Time spent, see tick_metrics_clock
+void tick_metrics_add(enum e_tick_phase phase, uint64 time_ns)
+{
+	if( !tick_metrics )
+		return;
+
+	tick_metrics_current.phase_ns[phase] += time_ns;
+}
+
+/// Name of a timer function for the tick metrics.
+/// Functions missing from the timer function list are named after their address, so they stay apart.
+/// @param func: Timer function
+/// @param buf: Buffer for the address of an unknown function
+/// @param size: Size of buf
+/// @return Name of the timer function
+static const char* tick_metrics_func_name(TimerFunc func, char* buf, size_t size)
+{
+	struct timer_func_list* tfl;
+
+	for( tfl=tfl_root; tfl != NULL; tfl=tfl->next )
+		if (func == tfl->func)
+			return tfl->name;
+
+	safesnprintf(buf, size, "unknown_0x%" PRIxPTR, reinterpret_cast<uintptr_t>(func));
+	return buf;
+}
+
+/// Display the breakdown of the last iterations of the main loop.
+static void tick_metrics_dump(uint64 time_ns)
+{
+	char func_name[32];
+	size_t first = tick_metrics_history_count - std::min<size_t>(tick_metrics_history_count, TICK_METRIC_HISTORY);
+
+	ShowWarning("Slow tick: main loop iteration took %.3f ms, last %" PRIuPTR " iterations (timer/recv/parse/send):\n", time_ns / 1000000., tick_metrics_history_count - first);
+
+	for( size_t i = first; i < tick_metrics_history_count; i++ ){
+		const s_tick_record& record = tick_metrics_history[i % TICK_METRIC_HISTORY];
+
+		ShowMessage("  %" PRtf ": %8.3f %8.3f %8.3f %8.3f ms", record.tick,
+			record.phase_ns[TICK_PHASE_TIMER] / 1000000., record.phase_ns[TICK_PHASE_RECV] / 1000000.,
+			record.phase_ns[TICK_PHASE_PARSE] / 1000000., record.phase_ns[TICK_PHASE_SEND] / 1000000.);
+
+		if( record.slowest_func != NULL )
+			ShowMessage(", slowest timer %s (%.3f ms)", tick_metrics_func_name(record.slowest_func, func_name, sizeof(func_name)), record.slowest_ns / 1000000.);
+
+		ShowMessage("\n");
+	}
+}
+
+/// Close the current main loop iteration and start a new one.
+/// The iteration goes into the histograms and the history, and the history is dumped if it was slow.
+void tick_metrics_commit(void)
+{
+	uint64 total = 0;
+
+	if( !tick_metrics )
+		return;
+
+	for( int i = 0; i < TICK_PHASE_MAX; i++ ){
+		tick_histogram_add(tick_metrics_histograms[i], tick_metrics_current.phase_ns[i]);
+		total += tick_metrics_current.phase_ns[i];
+	}
+	tick_histogram_add(tick_metrics_histograms[TICK_PHASE_MAX], total);
+
+	tick_metrics_current.tick = gettick();
+	tick_metrics_history[tick_metrics_history_count++ % TICK_METRIC_HISTORY] = tick_metrics_current;
+
+	// at most one dump per second, a server that is slow on every iteration would flood the console otherwise
+	if( tick_metrics_slow > 0 && total >= (uint64)tick_metrics_slow * 1000000 && DIFF_TICK(tick_metrics_current.tick, tick_metrics_last_dump) >= 1000 ){
+		tick_metrics_last_dump = tick_metrics_current.tick;
+		tick_metrics_dump(total);
+	}
+
+	tick_metrics_current = {};
+}
+
+/// Enable or disable the tick metrics.
+/// While disabled, the main loop only pays for a flag check per timer callback and phase.
+void tick_metrics_enable(bool enable)
+{
+	tick_metrics_current = {};
+	tick_metrics = enable;
+}
+
+/// Clear all collected tick metrics.
+void tick_metrics_reset(void)
+{
+	tick_metrics_timers.clear();
+	for( s_tick_histogram& histogram : tick_metrics_histograms )
+		histogram = {};
+	tick_metrics_history_count = 0;
+	tick_metrics_current = {};
+}
+
+/// Display the collected tick metrics.
+/// @param limit: Maximum amount of timer functions shown, 0 for all
+void tick_metrics_report(size_t limit)
+{
+	std::vector<std::pair<TimerFunc, s_timer_metric>> timers( tick_metrics_timers.begin(), tick_metrics_timers.end() );
+	char func_name[32];
+
+	for( int i = 0; i <= TICK_PHASE_MAX; i++ ){
+		const s_tick_histogram& histogram = tick_metrics_histograms[i];
+
+		if( histogram.count == 0 )
+			continue;
+
+		ShowInfo("%-9s: %10" PRIu64 " iterations, %12.3f ms total, p50 %8.3f ms, p90 %8.3f ms, p99 %8.3f ms, p99.9 %8.3f ms, max %8.3f ms\n",
+			i == TICK_PHASE_MAX ? "iteration" : tick_phase_names[i], histogram.count, histogram.time_ns / 1000000.,
+			tick_histogram_percentile(histogram, 0.5), tick_histogram_percentile(histogram, 0.9),
+			tick_histogram_percentile(histogram, 0.99), tick_histogram_percentile(histogram, 0.999),
+			histogram.max_ns / 1000000.);
+	}
+
+	std::sort(timers.begin(), timers.end(), []( const std::pair<TimerFunc, s_timer_metric>& a, const std::pair<TimerFunc, s_timer_metric>& b ){
+		return a.second.time_ns > b.second.time_ns;
+	});
+
+	ShowInfo("Timer functions: %" PRIuPTR " called.\n", timers.size());
+
+	for( size_t n = 0; n < timers.size() && (limit == 0 || n < limit); n++ ){
+		const s_timer_metric& metric = timers[n].second;
+
+		ShowInfo("  %-40s: %10" PRIu64 " calls, %10.3f ms total, %10.0f ns/call, %8.3f ms max\n", tick_metrics_func_name(timers[n].first, func_name, sizeof(func_name)), metric.count, metric.time_ns / 1000000., (double)metric.time_ns / metric.count, metric.max_ns / 1000000.);
+	}
+
+	if( tick_metrics_slow > 0 )
+		ShowInfo("Iterations of %" PRtf " ms or more dump the last %d iterations.\n", tick_metrics_slow, TICK_METRIC_HISTORY);
+}
+
+/// Write the collected tick metrics in the Prometheus text format, for a local collector to pick up.
+/// The file is replaced at once, so a reader never sees a partial file.
+/// @param file: Destination file
+/// @return true on success
+bool tick_metrics_export(const char* file)
+{
+	char tmp[1024];
+	char func_name[32];
+	FILE* fp;
+
+	safesnprintf(tmp, sizeof(tmp), "%s.tmp", file);
+
+	if( ( fp = fopen(tmp, "w") ) == NULL ){
+		ShowError("tick_metrics_export: Could not open '%s' for writing.\n", tmp);
+		return false;
+	}
+
+	fprintf(fp, "# TYPE rathena_tick_phase_seconds histogram\n");
+
+	for( int i = 0; i <= TICK_PHASE_MAX; i++ ){
+		const s_tick_histogram& histogram = tick_metrics_histograms[i];
+		const char* name = i == TICK_PHASE_MAX ? "iteration" : tick_phase_names[i];
+		uint64 seen = 0;
+
+		for( size_t bucket = 0; bucket < TICK_HISTOGRAM_BUCKETS; bucket++ ){
+			if( histogram.buckets[bucket] == 0 )
+				continue;
+
+			seen += histogram.buckets[bucket];
+			fprintf(fp, "rathena_tick_phase_seconds_bucket{phase=\"%s\",le=\"%.6f\"} %" PRIu64 "\n", name, tick_histogram_floor(bucket + 1) / 1000000., seen);
+		}
+
+		fprintf(fp, "rathena_tick_phase_seconds_bucket{phase=\"%s\",le=\"+Inf\"} %" PRIu64 "\n", name, histogram.count);
+		fprintf(fp, "rathena_tick_phase_seconds_sum{phase=\"%s\"} %.9f\n", name, histogram.time_ns / 1000000000.);
+		fprintf(fp, "rathena_tick_phase_seconds_count{phase=\"%s\"} %" PRIu64 "\n", name, histogram.count);
+	}
+
+	fprintf(fp, "# TYPE rathena_timer_seconds_total counter\n");
+	for( const auto& it : tick_metrics_timers )
+		fprintf(fp, "rathena_timer_seconds_total{func=\"%s\"} %.9f\n", tick_metrics_func_name(it.first, func_name, sizeof(func_name)), it.second.time_ns / 1000000000.);
+
+	fprintf(fp, "# TYPE rathena_timer_calls_total counter\n");
+	for( const auto& it : tick_metrics_timers )
+		fprintf(fp, "rathena_timer_calls_total{func=\"%s\"} %" PRIu64 "\n", tick_metrics_func_name(it.first, func_name, sizeof(func_name)), it.second.count);
+
+	fclose(fp);
+
+	// rename does not replace an existing file on Windows
+	remove(file);
+
+	if( rename(tmp, file) != 0 ){
+		ShowError("tick_metrics_export: Could not rename '%s' to '%s'.\n", tmp, file);
+		return false;
+	}
+
+	return true;
+}
+
+/// Console interface of the tick metrics, shared by all servers.
+/// @param command: on|off|reset|report [limit]|slow <ms>|export <file>
+void tick_metrics_console(const char* command)
+{
+	char file[256];
+
+	if( strcmpi("on", command) == 0 )
+		tick_metrics_enable(true);
+	else if( strcmpi("off", command) == 0 )
+		tick_metrics_enable(false);
+	else if( strcmpi("reset", command) == 0 )
+		tick_metrics_reset();
+	else if( strncmpi("report", command, 6) == 0 )
+		tick_metrics_report(strtoul(command + 6, nullptr, 10));
+	else if( strncmpi("slow", command, 4) == 0 ){
+		tick_metrics_slow = strtoll(command + 4, nullptr, 10);
+		ShowInfo("Console: Slow tick dump %s.\n", tick_metrics_slow > 0 ? "enabled" : "disabled");
+	}
+	else if( sscanf(command, "export %255s", file) == 1 ){
+		if( tick_metrics_export(file) )
+			ShowInfo("Console: Tick metrics written to '%s'.\n", file);
+	}
+	else
+		ShowInfo("Console: Usage tick_metrics:on|off|reset|report [limit]|slow <ms>|export <file>\n");
+}
+
 /*----------------------------
  * 	Get tick time
  *----------------------------*/
@@ -367,11 +702,17 @@ t_tick do_timer(t_tick tick)
 
 		if( timer_data[tid].func )
 		{
+			TimerFunc func = timer_data[tid].func;
+			uint64 start = tick_metrics ? tick_metrics_clock() : 0;
+
 			if( diff < -1000 )
 				// timer was delayed for more than 1 second, use current tick instead
 				timer_data[tid].func(tid, tick, timer_data[tid].id, timer_data[tid].data);
 			else
 				timer_data[tid].func(tid, timer_data[tid].tick, timer_data[tid].id, timer_data[tid].data);
+
+			if( tick_metrics && start != 0 ) // not when the callback itself enabled the metrics
+				tick_metrics_timer(func, tick_metrics_clock() - start);
 		}
 
 		// in the case the function didn't change anything...
@@ -530,5 +871,6 @@ void timer_final(void)
 
 	if (timer_data) aFree(timer_data);
 	BHEAP_CLEAR(timer_heap);
+	tick_metrics_timers.clear();
 	if (free_timer_list) aFree(free_timer_list);
 }
@@ -68,6 +68,26 @@ const char* timestamp2string(char* str, size_t size, time_t timestamp, const cha
 void split_time(int time, int* year, int* month, int* day, int* hour, int* minute, int* second);
 double solve_time(char* modif_p);
 
+/// Main loop phases measured by the tick metrics
+enum e_tick_phase : uint8 {
+	TICK_PHASE_TIMER = 0, ///< Timer callbacks run by do_timer
+	TICK_PHASE_RECV, ///< Reading from the sockets that have data
+	TICK_PHASE_PARSE, ///< Parse functions of the sessions
+	TICK_PHASE_SEND, ///< Sending the write fifos
+	TICK_PHASE_MAX
+};
+
+extern bool tick_metrics;
+
+uint64 tick_metrics_clock(void);
+void tick_metrics_add(enum e_tick_phase phase, uint64 time_ns);
+void tick_metrics_commit(void);
+void tick_metrics_enable(bool enable);
+void tick_metrics_reset(void);
+void tick_metrics_report(size_t limit);
+bool tick_metrics_export(const char* file);
+void tick_metrics_console(const char* command);
+
 t_tick do_timer(t_tick tick);
 void timer_init(void);
 void timer_final(void);
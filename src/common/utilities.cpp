@@ -136,6 +136,235 @@ constexpr char base62_dictionary[] = {
 	'U', 'V', 'W', 'X', 'Y', 'Z'
 };
 
+/**
+ * Builds the alias table for the given weights
+ * @param weights: Weight of every index
+ */
+void rathena::util::alias_table::build( const std::vector<uint32>& weights ){
+	size_t count = weights.size();
+	uint64 sum = 0;
+
+	this->threshold.assign( count, 0 );
+	this->alias.assign( count, 0 );
+	this->total = 0;
+
+	if( count == 0 ){
+		return;
+	}
+
+	for( uint32 weight : weights ){
+		sum += weight;
+	}
+
+	// Keep the sum drawable with rnd_value, huge weights lose some precision
+	uint32 shift = 0;
+
+	while( ( sum >> shift ) > SINT32_MAX / 2 ){
+		shift++;
+	}
+
+	std::vector<uint64> scaled( count );
+	uint64 scaled_total = 0;
+
+	for( size_t i = 0; i < count; i++ ){
+		scaled_total += weights[i] >> shift;
+	}
+
+	// Each column holds total/count, so weights are scaled by count to stay in integers
+	for( size_t i = 0; i < count; i++ ){
+		scaled[i] = ( scaled_total == 0 ? 1 : ( weights[i] >> shift ) ) * count;
+	}
+
+	if( scaled_total == 0 ){
+		scaled_total = count;
+	}
+
+	std::vector<size_t> small, large;
+
+	for( size_t i = 0; i < count; i++ ){
+		if( scaled[i] < scaled_total ){
+			small.push_back( i );
+		}else{
+			large.push_back( i );
+		}
+	}
+
+	while( !small.empty() && !large.empty() ){
+		size_t s = small.back();
+		size_t l = large.back();
+
+		small.pop_back();
+
+		this->threshold[s] = static_cast<uint32>( scaled[s] );
+		this->alias[s] = static_cast<uint32>( l );
+
+		// The large entry fills up the rest of the column
+		scaled[l] -= scaled_total - scaled[s];
+
+		if( scaled[l] < scaled_total ){
+			large.pop_back();
+			small.push_back( l );
+		}
+	}
+
+	// Whatever is left fills its own column completely
+	for( size_t i : large ){
+		this->threshold[i] = static_cast<uint32>( scaled_total );
+		this->alias[i] = static_cast<uint32>( i );
+	}
+
+	for( size_t i : small ){
+		this->threshold[i] = static_cast<uint32>( scaled_total );
+		this->alias[i] = static_cast<uint32>( i );
+	}
+
+	this->total = static_cast<uint32>( scaled_total );
+}
+
+/**
+ * Draws a random index
+ * @return Index according to the weights, 0 if the table is empty
+ */
+size_t rathena::util::alias_table::draw() const{
+	if( this->threshold.empty() ){
+		return 0;
+	}
+
+	size_t i = rnd_value( 0, static_cast<int32>( this->threshold.size() - 1 ) );
+
+	if( static_cast<uint32>( rnd_value( 0, this->total - 1 ) ) < this->threshold[i] ){
+		return i;
+	}else{
+		return this->alias[i];
+	}
+}
+
+/// Case folds a string the same way stristr and strcmpi compare characters
+std::string rathena::util::name_index::fold( const char* str ){
+	std::string folded = str;
+
+	for( char& c : folded ){
+		c = static_cast<char>( ::tolower( static_cast<unsigned char>( c ) ) );
+	}
+
+	return folded;
+}
+
+/// Sorts the keys and removes duplicates
+void rathena::util::name_index::unique_keys( std::vector<uint32>& out ){
+	std::sort( out.begin(), out.end() );
+	out.erase( std::unique( out.begin(), out.end() ), out.end() );
+}
+
+/**
+ * Adds a name for a key, empty names are ignored
+ * @param name: Name to add
+ * @param key: Key returned when the name matches
+ */
+void rathena::util::name_index::add( const std::string& name, uint32 key ){
+	if( name.empty() ){
+		return;
+	}
+
+	this->names.push_back( fold( name.c_str() ) );
+	this->keys.push_back( key );
+}
+
+/**
+ * Builds the sorted and trigram lookups, must be called after all names were added
+ */
+void rathena::util::name_index::build(){
+	this->sorted.resize( this->names.size() );
+	std::iota( this->sorted.begin(), this->sorted.end(), 0 );
+	std::sort( this->sorted.begin(), this->sorted.end(), [this]( uint32 a, uint32 b ){
+		return this->names[a] < this->names[b];
+	} );
+
+	this->trigrams.clear();
+
+	for( uint32 i = 0; i < this->names.size(); i++ ){
+		const std::string& name = this->names[i];
+
+		for( size_t j = 0; j + 3 <= name.size(); j++ ){
+			uint32 gram = ( static_cast<uint8>( name[j] ) << 16 ) | ( static_cast<uint8>( name[j + 1] ) << 8 ) | static_cast<uint8>( name[j + 2] );
+			std::vector<uint32>& list = this->trigrams[gram];
+
+			// Names are visited in order, so each list stays sorted
+			if( list.empty() || list.back() != i ){
+				list.push_back( i );
+			}
+		}
+	}
+}
+
+/**
+ * Finds all keys with a name containing the string, like stristr
+ * @param str: String to look for
+ * @param out: Matching keys
+ */
+void rathena::util::name_index::find_substring( const char* str, std::vector<uint32>& out ) const{
+	std::string needle = fold( str );
+
+	out.clear();
+
+	if( needle.size() < 3 ){
+		// Too short for a trigram, check every name
+		for( uint32 i = 0; i < this->names.size(); i++ ){
+			if( this->names[i].find( needle ) != std::string::npos ){
+				out.push_back( this->keys[i] );
+			}
+		}
+
+		unique_keys( out );
+		return;
+	}
+
+	// Start with the rarest trigram of the string, then only verify those candidates
+	const std::vector<uint32>* candidates = nullptr;
+
+	for( size_t j = 0; j + 3 <= needle.size(); j++ ){
+		uint32 gram = ( static_cast<uint8>( needle[j] ) << 16 ) | ( static_cast<uint8>( needle[j + 1] ) << 8 ) | static_cast<uint8>( needle[j + 2] );
+		auto it = this->trigrams.find( gram );
+
+		if( it == this->trigrams.end() ){
+			return;
+		}
+
+		if( candidates == nullptr || it->second.size() < candidates->size() ){
+			candidates = &it->second;
+		}
+	}
+
+	for( uint32 i : *candidates ){
+		if( this->names[i].find( needle ) != std::string::npos ){
+			out.push_back( this->keys[i] );
+		}
+	}
+
+	unique_keys( out );
+}
+
+/**
+ * Finds all keys with a name equal to the string, like strcmpi
+ * @param str: Name to look for
+ * @param out: Matching keys
+ */
+void rathena::util::name_index::find_exact( const char* str, std::vector<uint32>& out ) const{
+	std::string name = fold( str );
+
+	out.clear();
+
+	auto it = std::lower_bound( this->sorted.begin(), this->sorted.end(), name, [this]( uint32 i, const std::string& value ){
+		return this->names[i] < value;
+	} );
+
+	for( ; it != this->sorted.end() && this->names[*it] == name; ++it ){
+		out.push_back( this->keys[*it] );
+	}
+
+	unique_keys( out );
+}
+
 std::string rathena::util::base62_encode( uint32 val ){
 	std::string result = "";
 	while (val != 0) {
@@ -232,6 +232,68 @@ namespace rathena {
 			}
 		}
 
+		/**
+		 * Walker/Vose alias table for weighted random draws in constant time.
+		 * Build it once from the weights, then draw() returns index i with
+		 * probability weights[i] / sum(weights). If all weights are 0 every
+		 * index is equally likely.
+		 */
+		class alias_table {
+		private:
+			std::vector<uint32> threshold; ///< Chance out of total to keep the drawn column
+			std::vector<uint32> alias; ///< Index returned instead if the column is not kept
+			uint32 total;
+
+		public:
+			alias_table() : total( 0 ) {}
+
+			void build( const std::vector<uint32>& weights );
+			size_t draw() const;
+
+			bool empty() const{
+				return this->threshold.empty();
+			}
+
+			size_t size() const{
+				return this->threshold.size();
+			}
+		};
+
+		/**
+		 * Case insensitive name lookup for databases.
+		 * Names are case folded once and indexed by their trigrams for substring queries
+		 * and kept sorted for exact queries. A key can be added with several names.
+		 * Call build() after adding all names; queries return each matching key once, in ascending order.
+		 */
+		class name_index {
+		private:
+			std::vector<std::string> names; ///< Case folded names
+			std::vector<uint32> keys; ///< Key of each name
+			std::vector<uint32> sorted; ///< Name indexes sorted by name
+			std::unordered_map<uint32, std::vector<uint32>> trigrams; ///< Trigram -> name indexes containing it
+
+			static std::string fold( const char* str );
+			static void unique_keys( std::vector<uint32>& out );
+
+		public:
+			void clear(){
+				this->names.clear();
+				this->keys.clear();
+				this->sorted.clear();
+				this->trigrams.clear();
+			}
+
+			void add( const std::string& name, uint32 key );
+			void build();
+
+			void find_substring( const char* str, std::vector<uint32>& out ) const;
+			void find_exact( const char* str, std::vector<uint32>& out ) const;
+
+			bool empty() const{
+				return this->names.empty();
+			}
+		};
+
 #if __has_builtin( __builtin_add_overflow ) || ( defined( __GNUC__ ) && !defined( __clang__ ) && defined( GCC_VERSION  ) && GCC_VERSION >= 50100 )
 		template <typename T> bool safe_addition(T a, T b, T &result) {
 			return __builtin_add_overflow(a, b, &result);
@@ -63,6 +63,7 @@ static bool account_db_sql_iter_next(AccountDBIterator* self, struct mmo_account
 
 static bool mmo_auth_fromsql(AccountDB_SQL* db, struct mmo_account* acc, uint32 account_id);
 static bool mmo_auth_tosql(AccountDB_SQL* db, const struct mmo_account* acc, bool is_new, bool refresh_token);
+TIMER_FUNC(account_disable_webtoken_timer);
 
 /// public constructor
 AccountDB* account_db_sql(void) {
@@ -144,6 +145,8 @@ static bool account_db_sql_init(AccountDB* self) {
 
 	self->remove_webtokens( self );
 
+	add_timer_func_list( account_disable_webtoken_timer, "account_disable_webtoken_timer" );
+
 	return true;
 }
 
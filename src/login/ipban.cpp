@@ -3,8 +3,11 @@
 
 #include "ipban.hpp"
 
+#include <deque>
 #include <stdlib.h>
 #include <string.h>
+#include <time.h>
+#include <unordered_map>
 
 #include "../common/cbasetypes.hpp"
 #include "../common/showmsg.hpp"
@@ -13,7 +16,6 @@
 #include "../common/timer.hpp"
 
 #include "login.hpp"
-#include "loginlog.hpp"
 
 // login sql settings
 static char   ipban_db_hostname[64] = "127.0.0.1";
@@ -29,38 +31,110 @@ static Sql* sql_handle = NULL;
 static int cleanup_timer_id = INVALID_TIMER;
 static bool ipban_inited = false;
 
+/// Active bans, indexed by the number of octets of the ban pattern minus one.
+/// Each level maps the masked ip of a pattern to its release time, so checking an ip takes one lookup per level.
+static std::unordered_map<uint32, time_t> ipban_list[4];
+/// Ticks of the recent failed login attempts of each ip, oldest first
+static std::unordered_map<uint32, std::deque<t_tick>> ipban_failures;
+
 //early declaration
 TIMER_FUNC(ipban_cleanup);
 
+/**
+ * Get the netmask of a ban pattern level.
+ * @param level: number of octets of the pattern minus one
+ * @return netmask
+ */
+static inline uint32 ipban_mask(int level) {
+	return 0xFFFFFFFF << (8 * (3 - level));
+}
+
+/**
+ * Add a ban to the in-memory ban list.
+ * @param list: ban pattern, like '192.168.*.*'
+ * @param rtime: release time
+ * @return true if the pattern is valid, false otherwise
+ */
+static bool ipban_add(const char* list, time_t rtime) {
+	uint32 octets[4];
+	int count = 0;
+
+	while( count < 4 ) {
+		char* end;
+		unsigned long value = strtoul(list, &end, 10);
+
+		if( end == list || value > 255 )
+			break;
+		octets[count++] = (uint32)value;
+		list = end;
+		if( *list == '.' )
+			list++;
+		else
+			break;
+	}
+
+	if( count == 0 )
+		return false;
+
+	uint32 ip = 0;
+
+	for( int i = 0; i < count; i++ )
+		ip |= octets[i] << (8 * (3 - i));
+
+	time_t& entry = ipban_list[count - 1][ip];
+
+	if( entry < rtime )
+		entry = rtime;
+
+	return true;
+}
+
+/**
+ * Reload the active bans from the ban table.
+ * The current list is kept if the query fails.
+ */
+static void ipban_load(void) {
+	if( SQL_ERROR == Sql_Query(sql_handle, "SELECT `list`, UNIX_TIMESTAMP(`rtime`) FROM `%s` WHERE `rtime` > NOW()", ipban_table) ) {
+		Sql_ShowDebug(sql_handle);
+		return;
+	}
+
+	for( int i = 0; i < 4; i++ )
+		ipban_list[i].clear();
+
+	while( SQL_SUCCESS == Sql_NextRow(sql_handle) ) {
+		char* list;
+		char* rtime;
+
+		Sql_GetData(sql_handle, 0, &list, NULL);
+		Sql_GetData(sql_handle, 1, &rtime, NULL);
+
+		if( list == NULL || rtime == NULL || !ipban_add(list, (time_t)strtoll(rtime, NULL, 10)) )
+			ShowWarning("ipban_load: Ignoring invalid ban entry '%s'.\n", list ? list : "");
+	}
+
+	Sql_FreeResult(sql_handle);
+}
+
 /**
  * Check if ip is in the active bans list.
  * @param ip: ipv4 ip to check if ban
- * @return true if found or error, false if not in list
+ * @return true if found, false if not in list
  */
 bool ipban_check(uint32 ip) {
-	uint8* p = (uint8*)&ip;
-	char* data = NULL;
-	int matches;
-
 	if( !login_config.ipban )
 		return false;// ipban disabled
 
-	if( SQL_ERROR == Sql_Query(sql_handle, "SELECT count(*) FROM `%s` WHERE `rtime` > NOW() AND (`list` = '%u.*.*.*' OR `list` = '%u.%u.*.*' OR `list` = '%u.%u.%u.*' OR `list` = '%u.%u.%u.%u')",
-		ipban_table, p[3], p[3], p[2], p[3], p[2], p[1], p[3], p[2], p[1], p[0]) )
-	{
-		Sql_ShowDebug(sql_handle);
-		// close connection because we can't verify their connectivity.
-		return true;
-	}
+	time_t now = time(NULL);
 
-	if( SQL_ERROR == Sql_NextRow(sql_handle) )
-		return true;// Shouldn't happen, but just in case...
+	for( int i = 0; i < 4; i++ ) {
+		auto it = ipban_list[i].find(ip & ipban_mask(i));
 
-	Sql_GetData(sql_handle, 0, &data, NULL);
-	matches = atoi(data);
-	Sql_FreeResult(sql_handle);
+		if( it != ipban_list[i].end() && it->second > now )
+			return true;
+	}
 
-	return( matches > 0 );
+	return false;
 }
 
 /**
@@ -69,17 +143,26 @@ bool ipban_check(uint32 ip) {
  * @param ip: ipv4 ip to record the failure
  */
 void ipban_log(uint32 ip) {
-	unsigned long failures;
-
 	if( !login_config.ipban )
 		return;// ipban disabled
 
-	failures = loginlog_failedattempts(ip, login_config.dynamic_pass_failure_ban_interval);// how many times failed account? in one ip.
+	// how many times failed account? in one ip.
+	std::deque<t_tick>& failures = ipban_failures[ip];
+	t_tick tick = gettick();
+
+	failures.push_back(tick);
+	while( DIFF_TICK(tick, failures.front()) > (t_tick)login_config.dynamic_pass_failure_ban_interval * 60 * 1000 )
+		failures.pop_front();
 
 	// if over the limit, add a temporary ban entry
-	if( failures >= login_config.dynamic_pass_failure_ban_limit )
+	if( failures.size() >= login_config.dynamic_pass_failure_ban_limit )
 	{
 		uint8* p = (uint8*)&ip;
+
+		ipban_list[2][ip & ipban_mask(2)] = time(NULL) + login_config.dynamic_pass_failure_ban_duration * 60;
+		ipban_failures.erase(ip);
+
+		// the table is only kept for auditing and other servers' tools, checks use the in-memory list
 		if( SQL_ERROR == Sql_Query(sql_handle, "INSERT INTO `%s`(`list`,`btime`,`rtime`,`reason`) VALUES ('%u.%u.%u.*', NOW() , NOW() +  INTERVAL %d MINUTE ,'Password error ban')",
 			ipban_table, p[3], p[2], p[1], login_config.dynamic_pass_failure_ban_duration) )
 			Sql_ShowDebug(sql_handle);
@@ -88,8 +171,9 @@ void ipban_log(uint32 ip) {
 
 /**
  * Timered function to remove expired bans.
- *  Request all characters to update their registered ip and transmit their new ip.
- *  Performed each ip_sync_interval.
+ *  Also reloads the active bans, to pick up changes made to the table by other tools,
+ *  and forgets failed login attempts that are out of the dynamic ban interval.
+ *  Performed each ipban_cleanup_interval.
  * @param tid: timer id
  * @param tick: tick of execution
  * @param id: unused
@@ -103,6 +187,17 @@ TIMER_FUNC(ipban_cleanup){
 	if( SQL_ERROR == Sql_Query(sql_handle, "DELETE FROM `%s` WHERE `rtime` <= NOW()", ipban_table) )
 		Sql_ShowDebug(sql_handle);
 
+	ipban_load();
+
+	t_tick interval = (t_tick)login_config.dynamic_pass_failure_ban_interval * 60 * 1000;
+
+	for( auto it = ipban_failures.begin(); it != ipban_failures.end(); ) {
+		if( DIFF_TICK(tick, it->second.back()) > interval )
+			it = ipban_failures.erase(it);
+		else
+			it++;
+	}
+
 	return 0;
 }
 
@@ -218,6 +313,8 @@ void ipban_init(void) {
 	if( codepage[0] != '\0' && SQL_ERROR == Sql_SetEncoding(sql_handle, codepage) )
 		Sql_ShowDebug(sql_handle);
 
+	ipban_load();
+
 	if( login_config.ipban_cleanup_interval > 0 )
 	{ // set up periodic cleanup of connection history and active bans
 		add_timer_func_list(ipban_cleanup, "ipban_cleanup");
@@ -240,6 +337,10 @@ void ipban_final(void) {
 
 	ipban_cleanup(0,0,0,0); // always clean up on login-server stop
 
+	for( int i = 0; i < 4; i++ )
+		ipban_list[i].clear();
+	ipban_failures.clear();
+
 	// close connections
 	Sql_Free(sql_handle);
 	sql_handle = NULL;
@@ -9,7 +9,7 @@
 /**
  * Check if ip is in the active bans list.
  * @param ip: ipv4 ip to check if ban
- * @return true if found or error, false if not in list
+ * @return true if found, false if not in list
  */
 bool ipban_check(uint32 ip);
 
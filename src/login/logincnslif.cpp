@@ -139,6 +139,8 @@ int cnslif_parse(const char* buf){
 			}
 			ShowStatus("Console: Account '%s' created successfully.\n", username);
 		}
+		else if( strcmpi("tick_metrics", type) == 0 )
+			tick_metrics_console(command);
 	}
 	else if( strcmpi("help", type) == 0 ){
 		ShowInfo("Available commands:\n");
@@ -146,6 +148,7 @@ int cnslif_parse(const char* buf){
 		ShowInfo("\t server:alive => Checks if the server is running.\n");
 		ShowInfo("\t server:reloadconf => Reload config file: \"%s\"\n", login_config.loginconf_name);
 		ShowInfo("\t create:<username> <password> <sex:M|F> => Creates a new account.\n");
+		ShowInfo("\t tick_metrics:on|off|reset|report [limit]|slow <ms>|export <file> => Times the main loop phases and timer functions.\n");
 	}
 	return 1;
 }
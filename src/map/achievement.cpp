@@ -35,12 +35,60 @@ using namespace rathena;
 void AchievementDatabase::clear(){
 	TypesafeYamlDatabase::clear();
 	this->achievement_mobs.clear();
+	this->group_index.clear();
+	this->target_index.clear();
 }
 
 const std::string AchievementDatabase::getDefaultLocation(){
 	return std::string(db_path) + "/achievement_db.yml";
 }
 
+/**
+ * Compiles a condition into a native check, so it can be evaluated without running a script.
+ * Only constant true and comparisons of an event argument with a constant are supported.
+ * @param condition: Condition script
+ * @return Native check or nullptr if the condition has to be run as script
+ */
+static std::function<bool( const std::array<int, MAX_ACHIEVEMENT_OBJECTIVES>& )> achievement_compile_condition( const std::string& condition ){
+	const char* str = condition.c_str();
+	int length = 0;
+
+	sscanf( str, " true %n", &length );
+
+	if( length > 0 && str[length] == '\0' ){
+		return []( const std::array<int, MAX_ACHIEVEMENT_OBJECTIVES>& ){
+			return true;
+		};
+	}
+
+	int arg, value;
+	char op[3];
+
+	length = 0;
+
+	if( sscanf( str, " ARG%d %2[<>=!] %d %n", &arg, op, &value, &length ) != 3 || length == 0 || str[length] != '\0' || arg < 0 || arg >= MAX_ACHIEVEMENT_OBJECTIVES ){
+		return nullptr;
+	}
+
+	std::string comparison = op;
+
+	if( comparison == "==" ){
+		return [arg, value]( const std::array<int, MAX_ACHIEVEMENT_OBJECTIVES>& args ){ return args[arg] == value; };
+	}else if( comparison == "!=" ){
+		return [arg, value]( const std::array<int, MAX_ACHIEVEMENT_OBJECTIVES>& args ){ return args[arg] != value; };
+	}else if( comparison == ">=" ){
+		return [arg, value]( const std::array<int, MAX_ACHIEVEMENT_OBJECTIVES>& args ){ return args[arg] >= value; };
+	}else if( comparison == "<=" ){
+		return [arg, value]( const std::array<int, MAX_ACHIEVEMENT_OBJECTIVES>& args ){ return args[arg] <= value; };
+	}else if( comparison == ">" ){
+		return [arg, value]( const std::array<int, MAX_ACHIEVEMENT_OBJECTIVES>& args ){ return args[arg] > value; };
+	}else if( comparison == "<" ){
+		return [arg, value]( const std::array<int, MAX_ACHIEVEMENT_OBJECTIVES>& args ){ return args[arg] < value; };
+	}
+
+	return nullptr;
+}
+
 /**
  * Reads and parses an entry from the achievement_db.
  * @param node: YAML node containing the entry.
@@ -168,9 +216,7 @@ uint64 AchievementDatabase::parseBodyNode(const ryml::NodeRef& node){
 
 				uint32 mob_id = mob->id;
 
-				if( !this->mobexists( mob_id ) ){
-					this->achievement_mobs.push_back( mob_id );
-				}
+				this->achievement_mobs.insert( mob_id );
 
 				target->mob = mob_id;
 			}else{
@@ -190,6 +236,9 @@ uint64 AchievementDatabase::parseBodyNode(const ryml::NodeRef& node){
 			return 0;
 		}
 
+		achievement->condition_native = achievement_compile_condition( condition );
+		achievement->condition_args = condition.find( "ARG" ) != std::string::npos;
+
 		if( condition.find( "achievement_condition" ) == std::string::npos ){
 			condition = "achievement_condition( " + condition + " );";
 		}
@@ -201,8 +250,11 @@ uint64 AchievementDatabase::parseBodyNode(const ryml::NodeRef& node){
 
 		achievement->condition = parse_script( condition.c_str(), this->getCurrentFile().c_str(), this->getLineNumber(node["Condition"]), SCRIPT_IGNORE_EXTERNAL_BRACKETS );
 	}else{
-		if (!exists)
+		if (!exists){
 			achievement->condition = nullptr;
+			achievement->condition_native = nullptr;
+			achievement->condition_args = false;
+		}
 	}
 
 	if( this->nodeExists( node, "Map" ) ){
@@ -366,9 +418,44 @@ void AchievementDatabase::loadingFinished(){
 		ach->dependent_ids.shrink_to_fit();
 	}
 
+	// Index the achievements by the events that can update them
+	this->group_index.clear();
+	this->target_index.clear();
+
+	for( const auto &achit : *this ){
+		const std::shared_ptr<s_achievement_db> ach = achit.second;
+
+		if( ach->group == AG_BATTLE || ach->group == AG_TAMING ){
+			std::unordered_set<int> mobs;
+
+			for( const auto &target : ach->targets ){
+				if( target.second->mob > 0 && mobs.insert( target.second->mob ).second ){
+					this->target_index[( (uint64)ach->group << 32 ) | (uint32)target.second->mob].push_back( ach );
+				}
+			}
+		}else{
+			this->group_index[ach->group].push_back( ach );
+		}
+	}
+
 	TypesafeYamlDatabase::loadingFinished();
 }
 
+/**
+ * Get all achievements an event can update
+ * @param group: Achievement group of the event
+ * @param args: Event arguments
+ * @return Achievements or nullptr if there are none
+ */
+const std::vector<std::shared_ptr<s_achievement_db>>* AchievementDatabase::getAchievements( enum e_achievement_group group, const std::array<int, MAX_ACHIEVEMENT_OBJECTIVES>& args ){
+	if( group == AG_BATTLE || group == AG_TAMING ){
+		// Here args[0] contains the killed/tamed monster ID
+		return util::umap_find( this->target_index, ( (uint64)group << 32 ) | (uint32)args[0] );
+	}
+
+	return util::umap_find( this->group_index, (uint16)group );
+}
+
 AchievementDatabase achievement_db;
 
 /**
@@ -380,9 +467,7 @@ bool AchievementDatabase::mobexists( uint32 mob_id ){
 	if (!battle_config.feature_achievement)
 		return false;
 
-	auto it = std::find(this->achievement_mobs.begin(), this->achievement_mobs.end(), mob_id);
-
-	return (it != this->achievement_mobs.end()) ? true : false;
+	return this->achievement_mobs.find( mob_id ) != this->achievement_mobs.end();
 }
 
 const std::string AchievementLevelDatabase::getDefaultLocation(){
@@ -906,6 +991,21 @@ bool achievement_check_condition( struct script_code* condition, struct map_sess
 	return value != 0;
 }
 
+/**
+ * Check the condition of an achievement for an event
+ * @param ad: Achievement data
+ * @param sd: Player data
+ * @param args: Event arguments
+ * @return True if the condition is met or false otherwise
+ */
+static bool achievement_check_objective_condition( std::shared_ptr<s_achievement_db> ad, struct map_session_data* sd, const std::array<int, MAX_ACHIEVEMENT_OBJECTIVES>& args ){
+	if( ad->condition_native ){
+		return ad->condition_native( args );
+	}
+
+	return achievement_check_condition( ad->condition, sd );
+}
+
 /**
  * Check to see if an achievement's target count is complete
  * @param ad: Achievement data
@@ -976,7 +1076,7 @@ static bool achievement_update_objectives(struct map_session_data *sd, std::shar
 			if (!ad->condition)
 				return false;
 
-			if (!achievement_check_condition(ad->condition, sd)) // Parameters weren't met
+			if (!achievement_check_objective_condition(ad, sd, update_count)) // Parameters weren't met
 				return false;
 
 			changed = true;
@@ -991,7 +1091,7 @@ static bool achievement_update_objectives(struct map_session_data *sd, std::shar
 					current_count[it.first] += update_count[it.first];
 			}
 
-			if (!achievement_check_condition(ad->condition, sd)) // Parameters weren't met
+			if (!achievement_check_objective_condition(ad, sd, update_count)) // Parameters weren't met
 				return false;
 
 			changed = true;
@@ -1018,7 +1118,7 @@ static bool achievement_update_objectives(struct map_session_data *sd, std::shar
 				complete = true;
 			break;
 		case AG_GOAL_ACHIEVE:
-			if (!achievement_check_condition(ad->condition, sd)) // Parameters weren't met
+			if (!achievement_check_objective_condition(ad, sd, update_count)) // Parameters weren't met
 				return false;
 
 			changed = true;
@@ -1097,23 +1197,38 @@ void achievement_update_objective(struct map_session_data *sd, enum e_achievemen
 		std::array<int, MAX_ACHIEVEMENT_OBJECTIVES> count = {};
 
 		va_start(ap, arg_count);
-		for (int i = 0; i < arg_count; i++){
-			std::string name = "ARG" + std::to_string(i);
-
+		for (int i = 0; i < arg_count; i++)
 			count[i] = va_arg(ap, int);
+		va_end(ap);
+
+		const std::vector<std::shared_ptr<s_achievement_db>>* achievements = achievement_db.getAchievements(group, count);
+
+		if (achievements == nullptr)
+			return;
 
-			pc_setglobalreg( sd, add_str( name.c_str() ), (int)count[i] );
+		// Only condition scripts need the arguments as variables
+		bool args = std::any_of(achievements->begin(), achievements->end(), [](const std::shared_ptr<s_achievement_db>& ach) {
+			return ach->condition_args && !ach->condition_native;
+		});
+
+		if (args) {
+			for (int i = 0; i < arg_count; i++){
+				std::string name = "ARG" + std::to_string(i);
+
+				pc_setglobalreg( sd, add_str( name.c_str() ), (int)count[i] );
+			}
 		}
-		va_end(ap);
 
-		for (auto &ach : achievement_db)
-			achievement_update_objectives(sd, ach.second, group, count);
+		for (auto &ach : *achievements)
+			achievement_update_objectives(sd, ach, group, count);
 
 		// Remove variables that might have been set
-		for (int i = 0; i < arg_count; i++){
-			std::string name = "ARG" + std::to_string(i);
+		if (args) {
+			for (int i = 0; i < arg_count; i++){
+				std::string name = "ARG" + std::to_string(i);
 
-			pc_setglobalreg( sd, add_str( name.c_str() ), 0 );
+				pc_setglobalreg( sd, add_str( name.c_str() ), 0 );
+			}
 		}
 	}
 }
@@ -1184,6 +1299,8 @@ s_achievement_db::s_achievement_db()
 	, targets()
 	, dependent_ids()
 	, condition(nullptr)
+	, condition_native(nullptr)
+	, condition_args(false)
 	, mapindex(-1)
 	, rewards()
 	, score(0)
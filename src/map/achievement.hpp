@@ -5,10 +5,13 @@
 #define ACHIEVEMENT_HPP
 
 #include <algorithm>
+#include <array>
+#include <functional>
 #include <map>
 #include <memory>
 #include <string>
 #include <unordered_map>
+#include <unordered_set>
 #include <vector>
 
 #include "../common/mmo.hpp"
@@ -81,6 +84,8 @@ struct s_achievement_db {
 	std::map<uint16, std::shared_ptr<achievement_target>> targets;
 	std::vector<uint32> dependent_ids;
 	struct script_code* condition;
+	std::function<bool( const std::array<int, MAX_ACHIEVEMENT_OBJECTIVES>& )> condition_native; // Condition compiled to a native check, if it is simple enough
+	bool condition_args; // Condition script reads the ARGn event arguments
 	int16 mapindex;
 	struct ach_reward {
 		t_itemid nameid;
@@ -99,7 +104,9 @@ struct s_achievement_db {
 
 class AchievementDatabase : public TypesafeYamlDatabase<uint32, s_achievement_db>{
 private:
-	std::vector<uint32> achievement_mobs; // Avoids checking achievements on every mob killed
+	std::unordered_set<uint32> achievement_mobs; // Avoids checking achievements on every mob killed
+	std::unordered_map<uint16, std::vector<std::shared_ptr<s_achievement_db>>> group_index; // group -> achievements
+	std::unordered_map<uint64, std::vector<std::shared_ptr<s_achievement_db>>> target_index; // group << 32 | mob id -> achievements with that target
 
 public:
 	AchievementDatabase() : TypesafeYamlDatabase( "ACHIEVEMENT_DB", 2 ){
@@ -113,6 +120,7 @@ public:
 
 	// Additional
 	bool mobexists(uint32 mob_id);
+	const std::vector<std::shared_ptr<s_achievement_db>>* getAchievements( enum e_achievement_group group, const std::array<int, MAX_ACHIEVEMENT_OBJECTIVES>& args );
 };
 
 extern AchievementDatabase achievement_db;
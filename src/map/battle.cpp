@@ -3,6 +3,7 @@
 
 #include "battle.hpp"
 
+#include <chrono>
 #include <math.h>
 #include <stdlib.h>
 
@@ -489,6 +490,7 @@ int64 battle_attr_fix(struct block_list *src, struct block_list *target, int64 d
 				skill_unitsetting(src2,su->group->skill_id,su->group->skill_lv,x,y,1);
 				sg->val3 = -1;
 				sg->limit = DIFF_TICK(gettick(),sg->tick)+300;
+				skill_unit_wake(su);
 			}
 		}
 	}
@@ -8379,6 +8381,75 @@ struct Damage battle_calc_attack(int attack_type,struct block_list *bl,struct bl
 	return d;
 }
 
+/**
+ * Benchmark the damage calculation of a player against a monster.
+ * A temporary monster is spawned below the player and the calculation is repeated with a fixed random seed,
+ * so the checksum of the results can be compared between builds to prove a change doesn't alter any damage.
+ * The player's current equipment, stats and status changes are used as they are.
+ * @param sd: Attacking player
+ * @param mob_id: Monster used as target
+ * @param skill_id: Skill to calculate or 0 for a normal attack
+ * @param skill_lv: Skill level
+ * @param iterations: Number of calculations
+ * @param seed: Random seed
+ * @return True if the benchmark was run
+ */
+bool battle_calc_benchmark(map_session_data *sd, uint16 mob_id, uint16 skill_id, uint16 skill_lv, int iterations, uint32 seed)
+{
+	nullpo_retr(false, sd);
+
+	if (skill_id != 0 && skill_db.find(skill_id) == nullptr) {
+		ShowError("battle_calc_benchmark: Unknown skill %hu.\n", skill_id);
+		return false;
+	}
+
+	struct mob_data *md = mob_once_spawn_sub(&sd->bl, sd->bl.m, sd->bl.x, sd->bl.y, "--ja--", mob_id, "", SZ_SMALL, AI_NONE);
+
+	if (md == nullptr) {
+		ShowError("battle_calc_benchmark: Can't spawn monster %hu.\n", mob_id);
+		return false;
+	}
+
+	mob_spawn(md);
+
+	int attack_type = skill_id ? skill_get_type(skill_id) : BF_WEAPON;
+	uint64 checksum = 0;
+	int64 total = 0;
+	int misses = 0;
+	size_t memory = malloc_usage();
+
+	if (attack_type != BF_WEAPON && attack_type != BF_MAGIC && attack_type != BF_MISC)
+		attack_type = BF_WEAPON;
+
+	rnd_seed(seed);
+
+	auto start = std::chrono::steady_clock::now();
+
+	for (int i = 0; i < iterations; i++) {
+		struct Damage d;
+
+		switch (attack_type) {
+			case BF_WEAPON: d = battle_calc_weapon_attack(&sd->bl, &md->bl, skill_id, skill_lv, 0); break;
+			case BF_MAGIC:  d = battle_calc_magic_attack(&sd->bl, &md->bl, skill_id, skill_lv, 0); break;
+			default:        d = battle_calc_misc_attack(&sd->bl, &md->bl, skill_id, skill_lv, 0); break;
+		}
+
+		checksum = checksum * 1000003 + (uint64)(d.damage + d.damage2) * 31 + d.div_ * 7 + d.type;
+		total += d.damage + d.damage2;
+		if (d.damage + d.damage2 < 1)
+			misses++;
+	}
+
+	double elapsed = (double)std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - start).count();
+
+	ShowInfo("battle_calc_benchmark: %d calculations of skill %hu (lv %hu) against monster %hu in %.3f ms, %.0f ns/op.\n", iterations, skill_id, skill_lv, mob_id, elapsed / 1000000., iterations > 0 ? elapsed / iterations : 0.);
+	ShowInfo("battle_calc_benchmark: Seed %u, checksum %016" PRIx64 ", average damage %.1f, misses %d, memory change %" PRIdPTR " bytes.\n", seed, checksum, iterations > 0 ? (double)total / iterations : 0., misses, (intptr_t)(malloc_usage() - memory));
+
+	rnd_init();
+	unit_free(&md->bl, CLR_OUTSIGHT);
+	return true;
+}
+
 /*==========================================
  * Final damage return function
  *------------------------------------------
@@ -90,6 +90,7 @@ struct Damage {
 // Damage Calculation
 
 struct Damage battle_calc_attack(int attack_type,struct block_list *bl,struct block_list *target,uint16 skill_id,uint16 skill_lv,int flag);
+bool battle_calc_benchmark(map_session_data *sd, uint16 mob_id, uint16 skill_id, uint16 skill_lv, int iterations, uint32 seed);
 
 int64 battle_calc_return_damage(struct block_list *bl, struct block_list *src, int64 *, int flag, uint16 skill_id, bool status_reflect);
 
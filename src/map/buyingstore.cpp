@@ -20,10 +20,12 @@
 #include "log.hpp"  // log_pick_pc, log_zeny
 #include "npc.hpp"
 #include "pc.hpp"  // struct map_session_data
+#include "searchstore.hpp"  // searchstore_index_*
 
 //Autotrader
 static DBMap *buyingstore_autotrader_db; /// Holds autotrader info: char_id -> struct s_autotrader
 static void buyingstore_autotrader_remove(struct s_autotrader *at, bool remove);
+static void buyingstore_searchstore_index(struct map_session_data* sd);
 static int buyingstore_autotrader_free(DBKey key, DBData *data, va_list ap);
 
 /// constants (client-side restrictions)
@@ -251,6 +253,7 @@ int8 buyingstore_create( struct map_session_data* sd, int zenylimit, unsigned ch
 	clif_buyingstore_myitemlist(sd);
 	clif_buyingstore_entry( *sd );
 	idb_put(buyingstore_db, sd->status.char_id, sd);
+	buyingstore_searchstore_index(sd);
 
 	return 0;
 }
@@ -274,6 +277,7 @@ void buyingstore_close(struct map_session_data* sd) {
 		sd->buyer_id = 0;
 		memset(&sd->buyingstore, 0, sizeof(sd->buyingstore));
 		idb_remove(buyingstore_db, sd->status.char_id);
+		searchstore_index_remove(SEARCHTYPE_BUYING_STORE, sd->status.account_id);
 
 		// notify other players
 		clif_buyingstore_disappear_entry( *sd );
@@ -471,6 +475,8 @@ void buyingstore_trade( struct map_session_data* sd, uint32 account_id, unsigned
 		clif_buyingstore_update_item(pl_sd, item->itemId, item->amount, sd->status.char_id, zeny);
 	}
 
+	buyingstore_searchstore_index(pl_sd);
+
 	if( save_settings&CHARSAVE_VENDING ) {
 		chrif_save(sd, CSAVE_NORMAL|CSAVE_INVENTORY);
 		chrif_save(pl_sd, CSAVE_NORMAL|CSAVE_INVENTORY);
@@ -529,49 +535,25 @@ bool buyingstore_search(struct map_session_data* sd, t_itemid nameid)
 }
 
 
-/// Searches for all items in a buyingstore, that match given ids, price and possible cards.
-/// @return Whether or not the search should be continued.
-bool buyingstore_searchall(struct map_session_data* sd, const struct s_search_store_search* s)
+/// Refreshes the search store index entries of a buying store.
+static void buyingstore_searchstore_index(struct map_session_data* sd)
 {
-	unsigned int i, idx;
-	struct s_buyingstore_item* it;
-
-	nullpo_ret(sd);
+	searchstore_index_remove(SEARCHTYPE_BUYING_STORE, sd->status.account_id);
 
 	if( !sd->state.buyingstore )
 	{// not buying
-		return true;
+		return;
 	}
 
-	for( idx = 0; idx < s->item_count; idx++ )
+	for( unsigned int i = 0; i < sd->buyingstore.slots; i++ )
 	{
-		ARR_FIND( 0, sd->buyingstore.slots, i, sd->buyingstore.items[i].nameid == s->itemlist[idx].itemId && sd->buyingstore.items[i].amount );
-		if( i == sd->buyingstore.slots )
-		{// not found
-			continue;
-		}
-		it = &sd->buyingstore.items[i];
+		struct s_buyingstore_item* it = &sd->buyingstore.items[i];
 
-		if( s->min_price && s->min_price > (unsigned int)it->price )
-		{// too low price
+		if( !it->amount )
+		{// nothing left to buy
 			continue;
 		}
 
-		if( s->max_price && s->max_price < (unsigned int)it->price )
-		{// too high price
-			continue;
-		}
-
-		if( s->card_count )
-		{// ignore cards, as there cannot be any
-			;
-		}
-
-		// Check if the result set is full
-		if( s->search_sd->searchstore.items.size() >= (unsigned int)battle_config.searchstore_maxresults ){
-			return false;
-		}
-
 		std::shared_ptr<s_search_store_info_item> ssitem = std::make_shared<s_search_store_info_item>();
 
 		ssitem->store_id = sd->buyer_id;
@@ -586,10 +568,8 @@ bool buyingstore_searchall(struct map_session_data* sd, const struct s_search_st
 		ssitem->refine = 0;
 		ssitem->enchantgrade = 0;
 
-		s->search_sd->searchstore.items.push_back( ssitem );
+		searchstore_index_add(SEARCHTYPE_BUYING_STORE, ssitem);
 	}
-
-	return true;
 }
 
 /**
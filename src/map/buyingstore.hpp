@@ -8,7 +8,6 @@
 
 #include "map.hpp" //MESSAGE_SIZE
 
-struct s_search_store_search;
 struct map_session_data;
 
 #define MAX_BUYINGSTORE_SLOTS 5
@@ -61,7 +60,6 @@ void buyingstore_close(struct map_session_data* sd);
 void buyingstore_open(struct map_session_data* sd, uint32 account_id);
 void buyingstore_trade(struct map_session_data* sd, uint32 account_id, unsigned int buyer_id, const struct PACKET_CZ_REQ_TRADE_BUYING_STORE_sub* itemlist, unsigned int count);
 bool buyingstore_search(struct map_session_data* sd, t_itemid nameid);
-bool buyingstore_searchall(struct map_session_data* sd, const struct s_search_store_search* s);
 DBMap *buyingstore_getdb(void);
 void do_final_buyingstore(void);
 void do_init_buyingstore(void);
@@ -708,4 +708,7 @@ void do_final_cashshop( void ){
 void do_init_cashshop( void ){
 	cash_shop_defined = false;
 	cashshop_read_db();
+
+	add_timer_func_list( sale_start_timer, "sale_start_timer" );
+	add_timer_func_list( sale_end_timer, "sale_end_timer" );
 }
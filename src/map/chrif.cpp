@@ -46,7 +46,7 @@ static const int packet_len_table[0x3d] = { // U - used, F - free
 	11,10,10, 0,11, -1, 0,10,	// 2b10-2b17: U->2b10, U->2b11, U->2b12, F->2b13, U->2b14, U->2b15, F->2b16, U->2b17
 	 2,10, 2,-1,-1,-1, 2, 7,	// 2b18-2b1f: U->2b18, U->2b19, U->2b1a, U->2b1b, U->2b1c, U->2b1d, U->2b1e, U->2b1f
 	-1,10, 8, 2, 2,14,19,19,	// 2b20-2b27: U->2b20, U->2b21, U->2b22, U->2b23, U->2b24, U->2b25, U->2b26, U->2b27
-	-1, 0, 6,15, 0, 6,-1,-1,	// 2b28-2b2f: U->2b28, F->2b29, U->2b2a, U->2b2b, F->2b2c, U->2b2d, U->2b2e, U->2b2f
+	-1, 0, 6,15,10, 6,-1,-1,	// 2b28-2b2f: U->2b28, U->2b29, U->2b2a, U->2b2b, U->2b2c, U->2b2d, U->2b2e, U->2b2f
  };
 
 //Used Packets:
@@ -98,10 +98,10 @@ static const int packet_len_table[0x3d] = { // U - used, F - free
 //2b26: Outgoing, chrif_authreq -> 'client authentication request'
 //2b27: Incoming, chrif_authfail -> 'client authentication failed'
 //2b28: Outgoing, chrif_req_charban -> 'ban a specific char '
-//2b29: FREE
+//2b29: Outgoing, chrif_save_delta -> 'charsave of char XY account XY (changed blocks since the last save)'
 //2b2a: Outgoing, chrif_req_charunban -> 'unban a specific char '
 //2b2b: Incoming, chrif_parse_ack_vipActive -> vip info result
-//2b2c: FREE
+//2b2c: Incoming, chrif_save_resync -> 'delta save could not be applied, send the complete struct'
 //2b2d: Outgoing, chrif_bsdata_request -> request bonus_script for pc_authok'ed char.
 //2b2e: Outgoing, chrif_bsdata_save -> Send bonus_script of player for saving.
 //2b2f: Incoming, chrif_bsdata_received -> received bonus_script of player for loading.
@@ -171,6 +171,7 @@ bool chrif_auth_delete(uint32 account_id, uint32 char_id, enum sd_state state) {
 			if (node->sd->regs.arrays)
 				node->sd->regs.arrays->destroy(node->sd->regs.arrays, script_free_array_db);
 
+			chrif_save_free(node->sd);
 			aFree(node->sd);
 		}
 
@@ -280,6 +281,124 @@ int chrif_isconnected(void) {
 	return (session_isValid(char_fd) && chrif_state == 2);
 }
 
+/**
+ * Returns the version the next status save of a player is sent with
+ * @param sd: Player data
+ */
+static uint32 chrif_save_nextversion(struct map_session_data *sd) {
+	uint32 version = sd->status_version + 1;
+
+	// 0 is reserved for "no status known", skip it on wrap around
+	if( version == 0 )
+		version = 1;
+
+	return version;
+}
+
+/**
+ * Sends only the parts of the status that changed since the last save to the char-server.
+ * The status is split into blocks of CHARSAVE_DELTA_BLOCK bytes, a bitmask tells which blocks follow.
+ * The char-server applies them on top of the status of the base version, if it does not have that
+ * version anymore it asks for a complete save instead (see chrif_save_resync).
+ * @param sd: Player data
+ * @param status: Status to save
+ * @return True if the save was handled, false if the complete status has to be sent
+ */
+static bool chrif_save_delta(struct map_session_data *sd, const struct mmo_charstatus *status) {
+	const int blocks = (sizeof(struct mmo_charstatus) + CHARSAVE_DELTA_BLOCK - 1) / CHARSAVE_DELTA_BLOCK;
+	const int mask_len = (blocks + 7) / 8;
+	const uint8 *current = (const uint8 *)status, *saved;
+	uint8 mask[(sizeof(struct mmo_charstatus) / CHARSAVE_DELTA_BLOCK + 8) / 8] = {};
+	int changed = 0, payload = 0;
+
+	if( sd->status_saved == nullptr || sd->status_version == 0 )
+		return false;
+
+	saved = (const uint8 *)sd->status_saved;
+
+	for( int i = 0; i < blocks; i++ ){
+		int offset = i * CHARSAVE_DELTA_BLOCK;
+		int len = min( CHARSAVE_DELTA_BLOCK, sizeof(struct mmo_charstatus) - offset );
+
+		if( memcmp( current + offset, saved + offset, len ) == 0 )
+			continue;
+
+		mask[i / 8] |= 1 << (i % 8);
+		payload += len;
+		changed++;
+	}
+
+	if( changed == 0 ) // Nothing to save
+		return true;
+
+	// Not worth it, the complete status is almost as big
+	if( payload > (int)sizeof(struct mmo_charstatus) / 2 )
+		return false;
+
+	uint32 version = chrif_save_nextversion( sd );
+	int len = 22 + mask_len + payload;
+
+	WFIFOHEAD(char_fd, len);
+	WFIFOW(char_fd,0) = 0x2b29;
+	WFIFOW(char_fd,2) = len;
+	WFIFOL(char_fd,4) = status->account_id;
+	WFIFOL(char_fd,8) = status->char_id;
+	WFIFOL(char_fd,12) = sd->status_version;
+	WFIFOL(char_fd,16) = version;
+	WFIFOW(char_fd,20) = sizeof(struct mmo_charstatus);
+	memcpy( WFIFOP(char_fd,22), mask, mask_len );
+
+	int pos = 22 + mask_len;
+
+	for( int i = 0; i < blocks; i++ ){
+		if( !(mask[i / 8] & (1 << (i % 8))) )
+			continue;
+
+		int offset = i * CHARSAVE_DELTA_BLOCK;
+		int block_len = min( CHARSAVE_DELTA_BLOCK, sizeof(struct mmo_charstatus) - offset );
+
+		memcpy( WFIFOP(char_fd,pos), current + offset, block_len );
+		memcpy( (uint8 *)sd->status_saved + offset, current + offset, block_len );
+		pos += block_len;
+	}
+
+	WFIFOSET(char_fd, len);
+
+	sd->status_version = version;
+
+	return true;
+}
+
+/**
+ * Char-server could not apply a delta save, the next save has to send the complete status
+ * @param fd: Char-server fd
+ */
+static void chrif_save_resync(int fd) {
+	uint32 account_id = RFIFOL(fd,2), char_id = RFIFOL(fd,6);
+	struct map_session_data *sd = map_id2sd(account_id);
+
+	if( sd == nullptr || sd->status.char_id != char_id )
+		return;
+
+	sd->status_version = 0;
+	// Do not wait for the next autosave
+	chrif_save(sd, CSAVE_NORMAL);
+}
+
+/**
+ * Frees the copy of the last status sent to the char-server
+ * @param sd: Player data
+ */
+void chrif_save_free(struct map_session_data *sd) {
+	nullpo_retv(sd);
+
+	if( sd->status_saved != nullptr ){
+		aFree( sd->status_saved );
+		sd->status_saved = nullptr;
+	}
+	sd->status_version = 0;
+}
+
 /**
  * Saves character data.
  * @param sd: Player data
@@ -331,30 +450,39 @@ int chrif_save(struct map_session_data *sd, int flag) {
 	if (sd->vars_dirty)
 		intif_saveregistry(sd);
 
-	mmo_charstatus_len = sizeof(sd->status) + 13;
-	WFIFOHEAD(char_fd, mmo_charstatus_len);
-	WFIFOW(char_fd,0) = 0x2b01;
-	WFIFOW(char_fd,2) = mmo_charstatus_len;
-	WFIFOL(char_fd,4) = sd->status.account_id;
-	WFIFOL(char_fd,8) = sd->status.char_id;
-	WFIFOB(char_fd,12) = (flag&CSAVE_QUIT) ? 1 : 0; //Flag to tell char-server this character is quitting.
+	struct mmo_charstatus instance_status;
+	const struct mmo_charstatus *status = &sd->status;
 
 	// If the user is on a instance map, we have to fake his current position
 	if( map_getmapdata(sd->bl.m)->instance_id ){
-		struct mmo_charstatus status;
-
 		// Copy the whole status
-		memcpy( &status, &sd->status, sizeof( struct mmo_charstatus ) );
+		memcpy( &instance_status, &sd->status, sizeof( struct mmo_charstatus ) );
 		// Change his current position to his savepoint
-		memcpy( &status.last_point, &status.save_point, sizeof( struct point ) );
-		// Copy the copied status into the packet
-		memcpy( WFIFOP( char_fd, 13 ), &status, sizeof( struct mmo_charstatus ) );
-	} else {
-		// Copy the whole status into the packet
-		memcpy( WFIFOP( char_fd, 13 ), &sd->status, sizeof( struct mmo_charstatus ) );
+		memcpy( &instance_status.last_point, &instance_status.save_point, sizeof( struct point ) );
+		status = &instance_status;
 	}
 
-	WFIFOSET(char_fd, WFIFOW(char_fd,2));
+	// Final saves always carry the whole status, so the char-server never misses data of a leaving character
+	if( (flag&CSAVE_QUITTING) || !chrif_save_delta( sd, status ) ){
+		uint32 version = chrif_save_nextversion( sd );
+
+		mmo_charstatus_len = sizeof(sd->status) + 17;
+		WFIFOHEAD(char_fd, mmo_charstatus_len);
+		WFIFOW(char_fd,0) = 0x2b01;
+		WFIFOW(char_fd,2) = mmo_charstatus_len;
+		WFIFOL(char_fd,4) = sd->status.account_id;
+		WFIFOL(char_fd,8) = sd->status.char_id;
+		WFIFOB(char_fd,12) = (flag&CSAVE_QUIT) ? 1 : 0; //Flag to tell char-server this character is quitting.
+		// Copy the whole status into the packet
+		memcpy( WFIFOP( char_fd, 13 ), status, sizeof( struct mmo_charstatus ) );
+		WFIFOL(char_fd,mmo_charstatus_len - 4) = version;
+		WFIFOSET(char_fd, WFIFOW(char_fd,2));
+
+		if( sd->status_saved == nullptr )
+			CREATE( sd->status_saved, struct mmo_charstatus, 1 );
+		memcpy( sd->status_saved, status, sizeof( struct mmo_charstatus ) );
+		sd->status_version = version;
+	}
 
 	if( sd->status.pet_id > 0 && sd->pd )
 		intif_save_petdata(sd->status.account_id,&sd->pd->pet);
@@ -1822,6 +1950,7 @@ int chrif_parse(int fd) {
 			case 0x2b25: chrif_deadopt(RFIFOL(fd,2), RFIFOL(fd,6), RFIFOL(fd,10)); break;
 			case 0x2b27: chrif_authfail(fd); break;
 			case 0x2b2b: chrif_parse_ack_vipActive(fd); break;
+			case 0x2b2c: chrif_save_resync(fd); break;
 			case 0x2b2f: chrif_bsdata_received(fd); break;
 			default:
 				ShowError("chrif_parse : unknown packet (session #%d): 0x%x. Disconnecting.\n", fd, cmd);
@@ -1941,6 +2070,7 @@ int auth_db_final(DBKey key, DBData *data, va_list ap) {
 		if (node->sd->regs.arrays)
 			node->sd->regs.arrays->destroy(node->sd->regs.arrays, script_free_array_db);
 
+		chrif_save_free(node->sd);
 		aFree(node->sd);
 	}
 
@@ -1990,6 +2120,7 @@ void do_init_chrif(void) {
 
 	add_timer_func_list(check_connect_char_server, "check_connect_char_server");
 	add_timer_func_list(auth_db_cleanup, "auth_db_cleanup");
+	add_timer_func_list(send_usercount_tochar, "send_usercount_tochar");
 
 	// establish map-char connection if not present
 	add_timer_interval(gettick() + 1000, check_connect_char_server, 0, 0, 10 * 1000);
@@ -62,6 +62,7 @@ int chrif_skillcooldown_save(struct map_session_data *sd);
 int chrif_skillcooldown_load(int fd);
 
 int chrif_save(struct map_session_data* sd, int flag);
+void chrif_save_free(struct map_session_data *sd);
 int chrif_charselectreq(struct map_session_data* sd, uint32 s_ip);
 int chrif_changemapserver(struct map_session_data* sd, uint32 ip, uint16 port);
 
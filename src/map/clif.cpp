@@ -4,11 +4,14 @@
 
 #include "clif.hpp"
 
+#include <chrono>
 #include <cstdarg>
 #include <cstdio>
 #include <cstdlib>
 #include <cstring>
 #include <ctime>
+#include <unordered_map>
+#include <vector>
 
 #include "../common/cbasetypes.hpp"
 #include "../common/conf.hpp"
@@ -9820,6 +9823,7 @@ void clif_refresh_storagewindow(struct map_session_data *sd) {
 	// Notify the client that the storage is open
 	if( sd->state.storage_flag == 1 ) {
 		storage_sortitem(sd->storage.u.items_storage, ARRAYLENGTH(sd->storage.u.items_storage));
+		storage_slot_invalidate(&sd->storage);
 		clif_storagelist(sd, sd->storage.u.items_storage, ARRAYLENGTH(sd->storage.u.items_storage), storage_getName(0));
 		clif_updatestorageamount(sd, sd->storage.amount, sd->storage.max_amount);
 	}
@@ -9832,6 +9836,7 @@ void clif_refresh_storagewindow(struct map_session_data *sd) {
 			intif_request_guild_storage(sd->status.account_id, sd->status.guild_id);
 		else {
 			storage_sortitem(gstor->u.items_guild, ARRAYLENGTH(gstor->u.items_guild));
+			storage_slot_invalidate(gstor);
 			clif_storagelist(sd, gstor->u.items_guild, ARRAYLENGTH(gstor->u.items_guild), "Guild Storage");
 			clif_updatestorageamount(sd, gstor->amount, gstor->max_amount);
 		}
@@ -9839,6 +9844,7 @@ void clif_refresh_storagewindow(struct map_session_data *sd) {
 	// Notify the client that the premium storage is open
 	if (sd->state.storage_flag == 3) {
 		storage_sortitem(sd->premiumStorage.u.items_storage, ARRAYLENGTH(sd->premiumStorage.u.items_storage));
+		storage_slot_invalidate(&sd->premiumStorage);
 		clif_storagelist(sd, sd->premiumStorage.u.items_storage, ARRAYLENGTH(sd->premiumStorage.u.items_storage), storage_getName(sd->premiumStorage.stor_id));
 		clif_updatestorageamount(sd, sd->premiumStorage.amount, sd->premiumStorage.max_amount);
 	}
@@ -20862,6 +20868,7 @@ void clif_parse_merge_item_req(int fd, struct map_session_data* sd) {
 		unsigned short idx = indexes[i], amt = sd->inventory.u.items_inventory[idx].amount;
 		log_pick_pc(sd, LOG_TYPE_MERGE_ITEM, -amt, &sd->inventory.u.items_inventory[idx]);
 		memset(&sd->inventory.u.items_inventory[idx], 0, sizeof(sd->inventory.u.items_inventory[0]));
+		storage_slot_update(&sd->inventory, idx);
 		sd->inventory_data[idx] = NULL;
 		clif_delitem(sd, idx, amt, 0);
 	}
@@ -24895,6 +24902,221 @@ void clif_macro_reporter_status(map_session_data &sd, e_macro_report_status styp
 #endif
 }
 
+/// Length of a packet id for the outbound packet metrics (see packet_metrics_set_lenfunc)
+static int clif_packet_metrics_len( uint16 cmd ){
+	if( cmd > MAX_PACKET_DB )
+		return 0;
+
+	return packet_db[cmd].len;
+}
+
+/// Client packet capture file (see clif_packet_capture_start)
+/// Header: "RAPC" <version>.W <reserved>.W <packetver>.L
+/// Records: <tick offset>.L <packet len>.W <packet data>.?B
+#define PACKET_CAPTURE_MAGIC "RAPC"
+#define PACKET_CAPTURE_VERSION 1
+#define PACKET_CAPTURE_HEADER_SIZE 12
+#define PACKET_CAPTURE_RECORD_SIZE 6
+
+struct s_packet_capture {
+	FILE* fp;
+	t_tick start;
+};
+
+static std::unordered_map<uint32, s_packet_capture> packet_captures; // char_id -> capture
+
+/**
+ * Start capturing the client packets received from a character to a file
+ * @param char_id: Character ID
+ * @param filename: Capture file, overwritten if it exists
+ * @return True on success or false if the file can't be opened or the character is already captured
+ */
+bool clif_packet_capture_start(uint32 char_id, const char* filename) {
+	if( packet_captures.find( char_id ) != packet_captures.end() ){
+		ShowError( "clif_packet_capture_start: Packets of character %u are already captured.\n", char_id );
+		return false;
+	}
+
+	FILE* fp = fopen( filename, "wb" );
+
+	if( fp == nullptr ){
+		ShowError( "clif_packet_capture_start: Can't open '%s' for writing.\n", filename );
+		return false;
+	}
+
+	uint8 header[PACKET_CAPTURE_HEADER_SIZE];
+
+	memcpy( WBUFP( header, 0 ), PACKET_CAPTURE_MAGIC, 4 );
+	WBUFW( header, 4 ) = PACKET_CAPTURE_VERSION;
+	WBUFW( header, 6 ) = 0;
+	WBUFL( header, 8 ) = PACKETVER;
+	fwrite( header, sizeof( header ), 1, fp );
+
+	packet_captures[char_id] = { fp, gettick() };
+	return true;
+}
+
+/**
+ * Stop capturing the client packets of a character
+ * @param char_id: Character ID
+ * @return True if a capture was running
+ */
+bool clif_packet_capture_stop(uint32 char_id) {
+	auto it = packet_captures.find( char_id );
+
+	if( it == packet_captures.end() )
+		return false;
+
+	fclose( it->second.fp );
+	packet_captures.erase( it );
+	return true;
+}
+
+/// Append a received packet to the capture of the character, if any
+static void clif_packet_capture_write( map_session_data* sd, const uint8* data, int packet_len ){
+	auto it = packet_captures.find( sd->status.char_id );
+
+	if( it == packet_captures.end() )
+		return;
+
+	uint8 record[PACKET_CAPTURE_RECORD_SIZE];
+
+	WBUFL( record, 0 ) = (uint32)DIFF_TICK( gettick(), it->second.start );
+	WBUFW( record, 4 ) = (uint16)packet_len;
+	fwrite( record, sizeof( record ), 1, it->second.fp );
+	fwrite( data, packet_len, 1, it->second.fp );
+}
+
+/**
+ * Call the handler of a client packet, accounting its processing time when packet metrics are enabled
+ * @param fd: Session the packet is read from
+ * @param sd: Player of the session or nullptr if not yet connected
+ * @param cmd: Packet id
+ * @param packet_len: Packet length
+ */
+static void clif_parse_dispatch( int fd, map_session_data* sd, int cmd, int packet_len ){
+	if( packet_db[cmd].func == clif_parse_debug )
+		;
+	else if( packet_db[cmd].func == nullptr )
+		return;
+	else if( !sd && packet_db[cmd].func != clif_parse_WantToConnection )
+		return; //Only valid packet when there is no session
+	else if( sd && sd->bl.prev == NULL && packet_db[cmd].func != clif_parse_LoadEndAck )
+		return; //Only valid packet when player is not on a map
+
+	if( !packet_metrics ){
+		packet_db[cmd].func( fd, sd );
+		return;
+	}
+
+	auto start = std::chrono::steady_clock::now();
+
+	packet_db[cmd].func( fd, sd );
+
+	packet_metrics_add( PACKET_METRIC_IN, (uint16)cmd, packet_len, std::chrono::duration_cast<std::chrono::nanoseconds>( std::chrono::steady_clock::now() - start ).count() );
+}
+
+/**
+ * Feed captured client packets through the packet handlers of a connected player, as fast as possible.
+ * The session's receive buffer is swapped with each recorded packet, so obfuscation and the
+ * per-cycle packet limit of clif_parse are bypassed. Connection packets are skipped.
+ * @param sd: Player the packets are replayed for
+ * @param filename: Capture file
+ * @param repeat: Number of times the capture is replayed
+ * @return True if the capture was replayed
+ */
+bool clif_packet_replay( map_session_data* sd, const char* filename, int repeat ){
+	nullpo_retr( false, sd );
+
+	if( !session_isActive( sd->fd ) ){
+		ShowError( "clif_packet_replay: Character '%s' has no active session.\n", sd->status.name );
+		return false;
+	}
+
+	FILE* fp = fopen( filename, "rb" );
+
+	if( fp == nullptr ){
+		ShowError( "clif_packet_replay: Can't open '%s' for reading.\n", filename );
+		return false;
+	}
+
+	std::vector<uint8> data;
+	uint8 buf[4096];
+	size_t n;
+
+	while( ( n = fread( buf, 1, sizeof( buf ), fp ) ) > 0 )
+		data.insert( data.end(), buf, buf + n );
+	fclose( fp );
+
+	if( data.size() < PACKET_CAPTURE_HEADER_SIZE || memcmp( &data[0], PACKET_CAPTURE_MAGIC, 4 ) != 0 || RBUFW( &data[0], 4 ) != PACKET_CAPTURE_VERSION ){
+		ShowError( "clif_packet_replay: '%s' is not a packet capture.\n", filename );
+		return false;
+	}
+
+	if( RBUFL( &data[0], 8 ) != PACKETVER ){
+		ShowError( "clif_packet_replay: '%s' was captured with PACKETVER %u, but the server uses %d.\n", filename, RBUFL( &data[0], 8 ), PACKETVER );
+		return false;
+	}
+
+	// Collect the packets once, so the replay loop only measures the handlers
+	std::vector<std::pair<size_t, int>> packets; // offset, length
+
+	for( size_t pos = PACKET_CAPTURE_HEADER_SIZE; pos + PACKET_CAPTURE_RECORD_SIZE <= data.size(); ){
+		int packet_len = RBUFW( &data[0], pos + 4 );
+
+		pos += PACKET_CAPTURE_RECORD_SIZE;
+
+		if( packet_len < 2 || pos + packet_len > data.size() ){
+			ShowWarning( "clif_packet_replay: '%s' is truncated, replaying %" PRIuPTR " packets.\n", filename, packets.size() );
+			break;
+		}
+
+		int cmd = RBUFW( &data[0], pos );
+
+		if( cmd >= MIN_PACKET_DB && cmd <= MAX_PACKET_DB && packet_db[cmd].len != 0 && packet_db[cmd].func != clif_parse_WantToConnection )
+			packets.push_back( std::make_pair( pos, packet_len ) );
+
+		pos += packet_len;
+	}
+
+	struct socket_data* s = session[sd->fd];
+	unsigned char* rdata = s->rdata;
+	size_t rdata_pos = s->rdata_pos, rdata_size = s->rdata_size, max_rdata = s->max_rdata;
+	std::vector<uint8> packet;
+	uint64 count = 0;
+	auto start = std::chrono::steady_clock::now();
+
+	for( int i = 0; i < repeat; i++ ){
+		for( const auto& entry : packets ){
+			// Handlers may write to the buffer, always start from the recorded data
+			packet.assign( data.begin() + entry.first, data.begin() + entry.first + entry.second );
+
+			s->rdata = &packet[0];
+			s->rdata_pos = 0;
+			s->rdata_size = s->max_rdata = entry.second;
+
+			clif_parse_dispatch( sd->fd, sd, RBUFW( &packet[0], 0 ), entry.second );
+			count++;
+
+			if( s->flag.eof )
+				break;
+		}
+
+		if( s->flag.eof )
+			break;
+	}
+
+	s->rdata = rdata;
+	s->rdata_pos = rdata_pos;
+	s->rdata_size = rdata_size;
+	s->max_rdata = max_rdata;
+
+	double elapsed = std::chrono::duration_cast<std::chrono::duration<double, std::milli>>( std::chrono::steady_clock::now() - start ).count();
+
+	ShowInfo( "clif_packet_replay: Replayed %" PRIu64 " packets from '%s' in %.3f ms (%.0f packets/s).\n", count, filename, elapsed, elapsed > 0 ? count * 1000. / elapsed : 0. );
+	return true;
+}
+
 /*==========================================
  * Main client packet processing function
  *------------------------------------------*/
@@ -25019,19 +25241,13 @@ static int clif_parse(int fd)
 		sd->cryptKey = ((sd->cryptKey * clif_cryptKey[1]) + clif_cryptKey[2]) & 0xFFFFFFFF; // Update key for the next packet
 #endif
 
-	if( packet_db[cmd].func == clif_parse_debug )
-		packet_db[cmd].func(fd, sd);
-	else if( packet_db[cmd].func != NULL ) {
-		if( !sd && packet_db[cmd].func != clif_parse_WantToConnection )
-			; //Only valid packet when there is no session
-		else
-		if( sd && sd->bl.prev == NULL && packet_db[cmd].func != clif_parse_LoadEndAck )
-			; //Only valid packet when player is not on a map
-		else
-			packet_db[cmd].func(fd, sd);
-	}
+	if( sd && !packet_captures.empty() )
+		clif_packet_capture_write(sd, RFIFOP(fd, 0), packet_len);
+
+	clif_parse_dispatch(fd, sd, cmd, packet_len);
 #ifdef DUMP_UNKNOWN_PACKET
-	else DumpUnknown(fd,sd,cmd,packet_len);
+	if( packet_db[cmd].func == NULL )
+		DumpUnknown(fd,sd,cmd,packet_len);
 #endif
 	RFIFOSKIP(fd, packet_len);
 	}; // main loop end
@@ -25111,6 +25327,7 @@ void do_init_clif(void) {
 	packetdb_readdb();
 
 	set_defaultparse(clif_parse);
+	packet_metrics_set_lenfunc(clif_packet_metrics_len);
 	if( make_listen_bind(bind_ip,map_port) == -1 ) {
 		ShowFatalError("Failed to bind to port '" CL_WHITE "%d" CL_RESET "'\n",map_port);
 		exit(EXIT_FAILURE);
@@ -25131,5 +25348,9 @@ void do_init_clif(void) {
 }
 
 void do_final_clif(void) {
+	for( auto& capture : packet_captures )
+		fclose( capture.second.fp );
+	packet_captures.clear();
+
 	ers_destroy(delay_clearunit_ers);
 }
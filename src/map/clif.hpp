@@ -976,6 +976,11 @@ int clif_send(const void* buf, int len, struct block_list* bl, enum send_target
 void do_init_clif(void);
 void do_final_clif(void);
 
+// Client packet capture and replay
+bool clif_packet_capture_start(uint32 char_id, const char* filename);
+bool clif_packet_capture_stop(uint32 char_id);
+bool clif_packet_replay(map_session_data* sd, const char* filename, int repeat);
+
 // MAIL SYSTEM
 enum mail_send_result : uint8_t {
 	WRITE_MAIL_SUCCESS = 0x0,
@@ -1138,6 +1138,7 @@ void do_init_elemental(void) {
 	elemental_db.load();
 
 	add_timer_func_list(elemental_ai_timer,"elemental_ai_timer");
+	add_timer_func_list(elemental_summon_end,"elemental_summon_end");
 	add_timer_interval(gettick()+MIN_ELETHINKTIME,elemental_ai_timer,0,0,MIN_ELETHINKTIME);
 }
 
@@ -4,6 +4,7 @@
 #include "guild.hpp"
 
 #include <stdlib.h>
+#include <unordered_set>
 
 #include "../common/cbasetypes.hpp"
 #include "../common/database.hpp"
@@ -192,6 +193,7 @@ GuildSkillTreeDatabase guild_skill_tree_db;
 
 TIMER_FUNC(guild_payexp_timer);
 static TIMER_FUNC(guild_send_xy_timer);
+static std::unordered_set<int> guild_xy_dirty; // guild_id of the guilds that have to be checked by the next guild_send_xy_timer
 
 /* guild flags cache */
 struct npc_data **guild_flags;
@@ -453,12 +455,19 @@ TIMER_FUNC(guild_payexp_timer){
 	return 0;
 }
 
+/**
+ * Flags a guild to check its members for position changes on the next guild_send_xy_timer.
+ * @param guild_id: Guild ID, ignored if 0
+ */
+void guild_send_xy_mark(int guild_id) {
+	if( guild_id )
+		guild_xy_dirty.insert(guild_id);
+}
+
 /**
  * Taken from party_send_xy_timer_sub. [Skotlex]
- * @see DBApply
  */
-int guild_send_xy_timer_sub(DBKey key, DBData *data, va_list ap) {
-	struct guild *g = (struct guild *)db_data2ptr(data);
+static int guild_send_xy_timer_sub(struct guild *g) {
 	int i;
 
 	nullpo_ret(g);
@@ -481,7 +490,13 @@ int guild_send_xy_timer_sub(DBKey key, DBData *data, va_list ap) {
 
 //Code from party_send_xy_timer [Skotlex]
 static TIMER_FUNC(guild_send_xy_timer){
-	guild_db->foreach(guild_db,guild_send_xy_timer_sub,tick);
+	for( int guild_id : guild_xy_dirty ) {
+		struct guild *g = guild_search(guild_id);
+
+		if( g != nullptr )
+			guild_send_xy_timer_sub(g);
+	}
+	guild_xy_dirty.clear();
 	return 0;
 }
 
@@ -634,6 +649,8 @@ int guild_recv_info(struct guild *sg) {
 
 	nullpo_ret(sg);
 
+	guild_send_xy_mark(sg->guild_id);
+
 	if((g = guild_search(sg->guild_id))==NULL) {
 		guild_new = true;
 		g=(struct guild *)aCalloc(1,sizeof(struct guild));
@@ -1132,6 +1149,8 @@ int guild_recv_memberinfoshort(int guild_id,uint32 account_id,uint32 char_id,int
 	if(g == NULL)
 		return 0;
 
+	guild_send_xy_mark(guild_id);
+
 	for(i=0,alv=0,c=0,om=0;i<g->max_member;i++){
 		struct guild_member *m=&g->member[i];
 		if(!m->account_id) continue;
@@ -1524,6 +1524,7 @@ int intif_parse_LoadGuildStorage(int fd)
 	}
 
 	memcpy(gstor,RFIFOP(fd,13),sizeof(struct s_storage));
+	storage_slot_invalidate(gstor);
 	if( flag )
 		storage_guild_storageopen(sd);
 
@@ -2095,6 +2096,7 @@ void intif_parse_questlog(int fd)
 		}
 	}
 
+	quest_build_kill_index(sd);
 	quest_pc_login(sd);
 }
 
@@ -3474,6 +3476,7 @@ static bool intif_parse_StorageReceived(int fd)
 	}
 
 	memcpy(stor, p, sz_stor); //copy the items data to correct destination
+	storage_slot_invalidate(stor);
 
 	switch (type) {
 		case TABLE_INVENTORY: {
@@ -1182,6 +1182,15 @@ void ItemDatabase::loadingFinished(){
 		item_db.put( ITEMID_DUMMY, dummy_item );
 	}
 
+	this->nameIndex.clear();
+
+	for( const auto &it : *this ){
+		this->nameIndex.add( it.second->name, it.first );
+		this->nameIndex.add( it.second->ename, it.first );
+	}
+
+	this->nameIndex.build();
+
 	TypesafeCachedYamlDatabase::loadingFinished();
 }
 
@@ -1241,6 +1250,15 @@ std::shared_ptr<item_data> ItemDatabase::searchname( const char *name ){
 	return util::umap_find( this->nameToItemDataMap, lowername );
 }
 
+/**
+ * Finds all items with an aegis or display name containing the string
+ * @param str: String to look for (case insensitive)
+ * @param out: Matching item IDs in ascending order
+ */
+void ItemDatabase::searchname_partial( const char* str, std::vector<uint32>& out ){
+	this->nameIndex.find_substring( str, out );
+}
+
 ItemDatabase item_db;
 
 /**
@@ -2667,13 +2685,16 @@ ItemPackageDatabase item_package_db;
  *------------------------------------------*/
 uint16 itemdb_searchname_array(std::map<t_itemid, std::shared_ptr<item_data>> &data, uint16 size, const char *str)
 {
-	for (const auto &item : item_db) {
-		std::shared_ptr<item_data> id = item.second;
+	std::vector<uint32> matches;
+
+	item_db.searchname_partial(str, matches);
+
+	for (const uint32 &nameid : matches) {
+		std::shared_ptr<item_data> id = item_db.find(nameid);
 
 		if (id == nullptr)
 			continue;
-		if (stristr(id->name.c_str(), str) != nullptr || stristr(id->ename.c_str(), str) != nullptr || strcmpi(id->ename.c_str(), str) == 0)
-			data[id->nameid] = id;
+		data[id->nameid] = id;
 	}
 
 	if (data.size() > size)
@@ -2683,17 +2704,10 @@ uint16 itemdb_searchname_array(std::map<t_itemid, std::shared_ptr<item_data>> &d
 }
 
 std::shared_ptr<s_item_group_entry> get_random_itemsubgroup(std::shared_ptr<s_item_group_random> random) {
-	if (random == nullptr)
+	if (random == nullptr || random->entries.empty())
 		return nullptr;
 
-	for (size_t j = 0, max = random->data.size() * 3; j < max; j++) {
-		std::shared_ptr<s_item_group_entry> entry = util::umap_random(random->data);
-
-		if (entry->rate == 0 || rnd() % random->total_rate < entry->rate)	// always return entry for rate 0 ('must' item)
-			return entry;
-	}
-
-	return util::umap_random(random->data);
+	return random->entries[random->alias.draw()];
 }
 
 /**
@@ -3346,6 +3360,16 @@ void ItemGroupDatabase::loadingFinished() {
 			for (const auto &it : random.second->data) {
 				random.second->total_rate += it.second->rate;
 			}
+
+			// Entries with rate 0 ('must' item) are picked whenever they are rolled, which weighs them like the whole group
+			std::vector<uint32> weights;
+
+			random.second->entries.clear();
+			for (const auto &it : random.second->data) {
+				random.second->entries.push_back(it.second);
+				weights.push_back(it.second->rate > 0 ? it.second->rate : max(random.second->total_rate, 1));
+			}
+			random.second->alias.build(weights);
 		}
 	}
 
@@ -4249,25 +4273,13 @@ void s_random_opt_group::apply( struct item& item ){
 		item.option[i].param = 0;
 	};
 
-	// Apply Must options
-	for( size_t i = 0; i < this->slots.size(); i++ ){
-		// Try to apply an entry
-		for( size_t j = 0, max = this->slots[static_cast<uint16>(i)].size() * 3; j < max; j++ ){
-			std::shared_ptr<s_random_opt_group_entry> option = util::vector_random( this->slots[static_cast<uint16>(i)] );
-
-			if( rnd() % 10000 < option->chance ){
-				apply_sub( item.option[i], option );
-				break;
-			}
+	// Apply Must options, each slot always gets one of its options, picked by chance
+	for( const auto& slot : this->slots_alias ){
+		if( slot.second.empty() || slot.first >= MAX_ITEM_RDM_OPT ){
+			continue;
 		}
 
-		// If no entry was applied, assign one
-		if( item.option[i].id == 0 ){
-			std::shared_ptr<s_random_opt_group_entry> option = util::vector_random( this->slots[static_cast<uint16>(i)] );
-
-			// Apply an entry without checking the chance
-			apply_sub( item.option[i], option );
-		}
+		apply_sub( item.option[slot.first], this->slots[slot.first][slot.second.draw()] );
 	}
 
 	// Apply Random options (if available)
@@ -4287,6 +4299,26 @@ void s_random_opt_group::apply( struct item& item ){
 	}
 }
 
+/**
+ * Builds the alias tables of the group slots
+ */
+void RandomOptionGroupDatabase::loadingFinished() {
+	for (const auto &group : *this) {
+		group.second->slots_alias.clear();
+
+		for (const auto &slot : group.second->slots) {
+			std::vector<uint32> weights;
+
+			for (const auto &option : slot.second)
+				weights.push_back(option->chance);
+
+			group.second->slots_alias[slot.first].build(weights);
+		}
+	}
+
+	TypesafeYamlDatabase::loadingFinished();
+}
+
 /**
  * Reads and parses an entry from the item_randomopt_group.
  * @param node: YAML node containing the entry.
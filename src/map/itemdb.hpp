@@ -1141,6 +1141,7 @@ struct s_random_opt_group {
 	uint16 id;
 	std::string name;
 	std::map<uint16, std::vector<std::shared_ptr<s_random_opt_group_entry>>> slots;
+	std::map<uint16, rathena::util::alias_table> slots_alias; /// Draw by chance over each slot's options
 	uint16 max_random;
 	std::vector<std::shared_ptr<s_random_opt_group_entry>> random_options;
 
@@ -1173,6 +1174,7 @@ public:
 
 	const std::string getDefaultLocation() override;
 	uint64 parseBodyNode(const ryml::NodeRef& node) override;
+	void loadingFinished() override;
 
 	// Additional
 	bool add_option(const ryml::NodeRef& node, std::shared_ptr<s_random_opt_group_entry> &entry);
@@ -1204,6 +1206,8 @@ struct s_item_group_random
 {
 	uint32 total_rate;
 	std::unordered_map<t_itemid, std::shared_ptr<s_item_group_entry>> data; /// item ID, s_item_group_entry
+	std::vector<std::shared_ptr<s_item_group_entry>> entries; /// Entries of data in the order of alias
+	rathena::util::alias_table alias; /// Weighted draw over entries, built when loading finished
 
 	std::shared_ptr<s_item_group_entry> get_random_itemsubgroup();
 };
@@ -1323,6 +1327,7 @@ class ItemDatabase : public TypesafeCachedYamlDatabase<t_itemid, item_data> {
 private:
 	std::unordered_map<std::string, std::shared_ptr<item_data>> nameToItemDataMap;
 	std::unordered_map<std::string, std::shared_ptr<item_data>> aegisNameToItemDataMap;
+	rathena::util::name_index nameIndex; // Aegis and display names for partial name searches
 
 	e_sex defaultGender( const ryml::NodeRef& node, std::shared_ptr<item_data> id );
 
@@ -1339,11 +1344,13 @@ public:
 
 		this->nameToItemDataMap.clear();
 		this->aegisNameToItemDataMap.clear();
+		this->nameIndex.clear();
 	}
 
 	// Additional
 	std::shared_ptr<item_data> searchname( const char* name );
 	std::shared_ptr<item_data> search_aegisname( const char *name );
+	void searchname_partial( const char* str, std::vector<uint32>& out );
 };
 
 extern ItemDatabase item_db;
@@ -137,6 +137,8 @@ int map_port=0;
 
 int autosave_interval = DEFAULT_AUTOSAVE_INTERVAL;
 int minsave_interval = 100;
+int autosave_budget = 0;
+int autosave_priority_zeny = 1000000;
 int16 save_settings = CHARSAVE_ALL;
 bool agit_flag = false;
 bool agit2_flag = false;
@@ -365,11 +367,26 @@ int map_addblock(struct block_list* bl)
 		bl->prev = &bl_head;
 		if (bl->next) bl->next->prev = bl;
 		mapdata->block_mob[pos] = bl;
+	} else if (bl->type != BL_PC && mapdata->block_pc_last[pos] != nullptr) {
+		// Keep players in front, so scans for players only can stop at the first other object
+		struct block_list *last = mapdata->block_pc_last[pos];
+
+		bl->next = last->next;
+		bl->prev = last;
+		if (bl->next) bl->next->prev = bl;
+		last->next = bl;
 	} else {
 		bl->next = mapdata->block[pos];
 		bl->prev = &bl_head;
 		if (bl->next) bl->next->prev = bl;
 		mapdata->block[pos] = bl;
+		if (bl->type == BL_PC && mapdata->block_pc_last[pos] == nullptr)
+			mapdata->block_pc_last[pos] = bl;
+	}
+
+	if (bl->type == BL_PC) { // Update the position on the party and guild members' minimap
+		party_send_xy_mark(((TBL_PC*)bl)->status.party_id);
+		guild_send_xy_mark(((TBL_PC*)bl)->status.guild_id);
 	}
 
 #ifdef CELL_NOSTACK
@@ -404,6 +421,9 @@ int map_delblock(struct block_list* bl)
 
 	pos = bl->x/BLOCK_SIZE+(bl->y/BLOCK_SIZE)*mapdata->bxs;
 
+	if (bl->type == BL_PC && mapdata->block_pc_last[pos] == bl)
+		mapdata->block_pc_last[pos] = (bl->prev == &bl_head) ? nullptr : bl->prev;
+
 	if (bl->next)
 		bl->next->prev = bl->prev;
 	if (bl->prev == &bl_head) {
@@ -481,6 +501,10 @@ int map_moveblock(struct block_list *bl, int x1, int y1, t_tick tick)
 #ifdef CELL_NOSTACK
 	else map_addblcell(bl);
 #endif
+	if (!moveblock && bl->type == BL_PC) { // Update the position on the party and guild members' minimap, map_addblock already did it otherwise
+		party_send_xy_mark(((TBL_PC*)bl)->status.party_id);
+		guild_send_xy_mark(((TBL_PC*)bl)->status.guild_id);
+	}
 
 	if (bl->type&BL_CHAR) {
 
@@ -548,6 +572,17 @@ int map_moveblock(struct block_list *bl, int x1, int y1, t_tick tick)
 	return 0;
 }
 
+/**
+ * Check if a scan of a block list can stop at this object.
+ * Players are in front of all other objects, so a scan for players only is done after the last player.
+ * @param bl: Current object of the block list
+ * @param type: Object types that are looked for
+ */
+static inline bool map_blocklist_done(struct block_list* bl, int type)
+{
+	return bl->type != BL_PC && !(type&~(BL_PC|BL_MOB));
+}
+
 /*==========================================
  * Counts specified number of objects on given cell.
  * flag:
@@ -567,7 +602,7 @@ int map_count_oncell(int16 m, int16 x, int16 y, int type, int flag)
 	by = y/BLOCK_SIZE;
 
 	if (type&~BL_MOB)
-		for( bl = mapdata->block[bx+by*mapdata->bxs] ; bl != NULL ; bl = bl->next )
+		for( bl = mapdata->block[bx+by*mapdata->bxs] ; bl != NULL && !map_blocklist_done(bl, type) ; bl = bl->next )
 			if(bl->x == x && bl->y == y && bl->type&type) {
 				if (bl->type == BL_NPC) {	// Don't count hidden or invisible npc. Cloaked npc are counted
 					npc_data *nd = BL_CAST(BL_NPC, bl);
@@ -658,7 +693,7 @@ int map_foreachinrangeV(int (*func)(struct block_list*,va_list),struct block_lis
 	if ( type&~BL_MOB ) {
 		for( by = y0 / BLOCK_SIZE; by <= y1 / BLOCK_SIZE; by++ ) {
 			for( bx = x0 / BLOCK_SIZE; bx <= x1 / BLOCK_SIZE; bx++ ) {
-				for(bl = mapdata->block[ bx + by * mapdata->bxs ]; bl != NULL; bl = bl->next ) {
+				for(bl = mapdata->block[ bx + by * mapdata->bxs ]; bl != NULL && !map_blocklist_done(bl, type); bl = bl->next ) {
 					if( bl->type&type
 						&& bl->x >= x0 && bl->x <= x1 && bl->y >= y0 && bl->y <= y1
 #ifdef CIRCULAR_AREA
@@ -786,7 +821,7 @@ int map_foreachinareaV(int(*func)(struct block_list*, va_list), int16 m, int16 x
 	if( type&~BL_MOB ) {
 		for (by = y0 / BLOCK_SIZE; by <= y1 / BLOCK_SIZE; by++) {
 			for (bx = x0 / BLOCK_SIZE; bx <= x1 / BLOCK_SIZE; bx++) {
-				for(bl = mapdata->block[bx + by * mapdata->bxs]; bl != NULL; bl = bl->next) {
+				for(bl = mapdata->block[bx + by * mapdata->bxs]; bl != NULL && !map_blocklist_done(bl, type); bl = bl->next) {
 					if ( bl->type&type
 						&& bl->x >= x0 && bl->x <= x1 && bl->y >= y0 && bl->y <= y1
 						&& ( !wall_check || path_search_long(NULL, m, cx, cy, bl->x, bl->y, CELL_CHKWALL) )
@@ -886,7 +921,7 @@ int map_forcountinrange(int (*func)(struct block_list*,va_list), struct block_li
 	if ( type&~BL_MOB )
 		for ( by = y0 / BLOCK_SIZE; by <= y1 / BLOCK_SIZE; by++ ) {
 			for( bx = x0 / BLOCK_SIZE; bx <= x1 / BLOCK_SIZE; bx++ ) {
-				for( bl = mapdata->block[ bx + by * mapdata->bxs ]; bl != NULL; bl = bl->next ) {
+				for( bl = mapdata->block[ bx + by * mapdata->bxs ]; bl != NULL && !map_blocklist_done(bl, type); bl = bl->next ) {
 					if( bl->type&type
 						&& bl->x >= x0 && bl->x <= x1 && bl->y >= y0 && bl->y <= y1
 #ifdef CIRCULAR_AREA
@@ -960,7 +995,7 @@ int map_forcountinarea(int (*func)(struct block_list*,va_list), int16 m, int16 x
 	if ( type&~BL_MOB )
 		for( by = y0 / BLOCK_SIZE; by <= y1 / BLOCK_SIZE; by++ )
 			for( bx = x0 / BLOCK_SIZE; bx <= x1 / BLOCK_SIZE; bx++ )
-				for( bl = mapdata->block[ bx + by * mapdata->bxs ]; bl != NULL; bl = bl->next )
+				for( bl = mapdata->block[ bx + by * mapdata->bxs ]; bl != NULL && !map_blocklist_done(bl, type); bl = bl->next )
 					if( bl->type&type && bl->x >= x0 && bl->x <= x1 && bl->y >= y0 && bl->y <= y1 && bl_list_count < BL_LIST_MAX )
 						bl_list[ bl_list_count++ ] = bl;
 
@@ -1015,6 +1050,10 @@ int map_foreachinmovearea(int (*func)(struct block_list*,va_list), struct block_
 		return 0;
 	}
 
+	// Only players are looked for, but nobody has finished loading this map
+	if( !(type&~BL_PC) && mapdata->users <= 0 )
+		return 0;
+
 	x0 = center->x - range;
 	x1 = center->x + range;
 	y0 = center->y - range;
@@ -1047,7 +1086,7 @@ int map_foreachinmovearea(int (*func)(struct block_list*,va_list), struct block_
 		for( by = y0 / BLOCK_SIZE; by <= y1 / BLOCK_SIZE; by++ ) {
 			for( bx = x0 / BLOCK_SIZE; bx <= x1 / BLOCK_SIZE; bx++ ) {
 				if ( type&~BL_MOB ) {
-					for( bl = mapdata->block[ bx + by * mapdata->bxs ]; bl != NULL; bl = bl->next ) {
+					for( bl = mapdata->block[ bx + by * mapdata->bxs ]; bl != NULL && !map_blocklist_done(bl, type); bl = bl->next ) {
 						if( bl->type&type &&
 							bl->x >= x0 && bl->x <= x1 &&
 							bl->y >= y0 && bl->y <= y1 &&
@@ -1066,23 +1105,41 @@ int map_foreachinmovearea(int (*func)(struct block_list*,va_list), struct block_
 			}
 		}
 	} else { // Diagonal movement
+		int16 sx0, sx1, sy0, sy1;
+
 		x0 = i16max(x0, 0);
 		y0 = i16max(y0, 0);
 		x1 = i16min(x1, mapdata->xs - 1);
 		y1 = i16min(y1, mapdata->ys - 1);
 
+		// Strips of cells that changed visibility, only blocks touching them have to be scanned
+		if( dx > 0 ){
+			sx0 = x0;
+			sx1 = i16min(x0 + dx - 1, x1);
+		}else{
+			sx0 = i16max(x1 + dx + 1, x0);
+			sx1 = x1;
+		}
+		if( dy > 0 ){
+			sy0 = y0;
+			sy1 = i16min(y0 + dy - 1, y1);
+		}else{
+			sy0 = i16max(y1 + dy + 1, y0);
+			sy1 = y1;
+		}
+
 		for( by = y0 / BLOCK_SIZE; by <= y1 / BLOCK_SIZE; by++ ) {
 			for( bx = x0 / BLOCK_SIZE; bx <= x1 / BLOCK_SIZE; bx++ ) {
+				if( ( bx < sx0 / BLOCK_SIZE || bx > sx1 / BLOCK_SIZE ) && ( by < sy0 / BLOCK_SIZE || by > sy1 / BLOCK_SIZE ) )
+					continue; // Block is inside the area that stays in sight
 				if ( type & ~BL_MOB ) {
-					for( bl = mapdata->block[ bx + by * mapdata->bxs ]; bl != NULL; bl = bl->next ) {
+					for( bl = mapdata->block[ bx + by * mapdata->bxs ]; bl != NULL && !map_blocklist_done(bl, type); bl = bl->next ) {
 						if( bl->type&type &&
 							bl->x >= x0 && bl->x <= x1 &&
 							bl->y >= y0 && bl->y <= y1 &&
 							bl_list_count < BL_LIST_MAX )
-						if( ( dx > 0 && bl->x < x0 + dx) ||
-							( dx < 0 && bl->x > x1 + dx) ||
-							( dy > 0 && bl->y < y0 + dy) ||
-							( dy < 0 && bl->y > y1 + dy) )
+						if( ( bl->x >= sx0 && bl->x <= sx1 ) ||
+							( bl->y >= sy0 && bl->y <= sy1 ) )
 							bl_list[ bl_list_count++ ] = bl;
 					}
 				}
@@ -1091,10 +1148,8 @@ int map_foreachinmovearea(int (*func)(struct block_list*,va_list), struct block_
 						if( bl->x >= x0 && bl->x <= x1 &&
 							bl->y >= y0 && bl->y <= y1 &&
 							bl_list_count < BL_LIST_MAX)
-						if( ( dx > 0 && bl->x < x0 + dx) ||
-							( dx < 0 && bl->x > x1 + dx) ||
-							( dy > 0 && bl->y < y0 + dy) ||
-							( dy < 0 && bl->y > y1 + dy) )
+						if( ( bl->x >= sx0 && bl->x <= sx1 ) ||
+							( bl->y >= sy0 && bl->y <= sy1 ) )
 							bl_list[ bl_list_count++ ] = bl;
 					}
 				}
@@ -1144,7 +1199,7 @@ int map_foreachincell(int (*func)(struct block_list*,va_list), int16 m, int16 x,
 	bx = x / BLOCK_SIZE;
 
 	if( type&~BL_MOB )
-		for( bl = mapdata->block[ bx + by * mapdata->bxs ]; bl != NULL; bl = bl->next )
+		for( bl = mapdata->block[ bx + by * mapdata->bxs ]; bl != NULL && !map_blocklist_done(bl, type); bl = bl->next )
 			if( bl->type&type && bl->x == x && bl->y == y && bl_list_count < BL_LIST_MAX )
 				bl_list[ bl_list_count++ ] = bl;
 	if( type&BL_MOB )
@@ -1274,7 +1329,7 @@ int map_foreachinpath(int (*func)(struct block_list*,va_list),int16 m,int16 x0,i
 	if ( type&~BL_MOB )
 		for ( by = my0 / BLOCK_SIZE; by <= my1 / BLOCK_SIZE; by++ ) {
 			for( bx = mx0 / BLOCK_SIZE; bx <= mx1 / BLOCK_SIZE; bx++ ) {
-				for( bl = mapdata->block[ bx + by * mapdata->bxs ]; bl != NULL; bl = bl->next ) {
+				for( bl = mapdata->block[ bx + by * mapdata->bxs ]; bl != NULL && !map_blocklist_done(bl, type); bl = bl->next ) {
 					if( bl->prev && bl->type&type && bl_list_count < BL_LIST_MAX ) {
 						xi = bl->x;
 						yi = bl->y;
@@ -1434,7 +1489,7 @@ int map_foreachindir(int(*func)(struct block_list*, va_list), int16 m, int16 x0,
 	if (type&~BL_MOB) {
 		for (by = my0 / BLOCK_SIZE; by <= my1 / BLOCK_SIZE; by++) {
 			for (bx = mx0 / BLOCK_SIZE; bx <= mx1 / BLOCK_SIZE; bx++) {
-				for (bl = mapdata->block[bx + by * mapdata->bxs]; bl != NULL; bl = bl->next) {
+				for (bl = mapdata->block[bx + by * mapdata->bxs]; bl != NULL && !map_blocklist_done(bl, type); bl = bl->next) {
 					if (bl->prev && bl->type&type && bl_list_count < BL_LIST_MAX) {
 						//Check if inside search area
 						if (bl->x < mx0 || bl->x > mx1 || bl->y < my0 || bl->y > my1)
@@ -1540,7 +1595,7 @@ int map_foreachinmap(int (*func)(struct block_list*,va_list), int16 m, int type,
 
 	if( type&~BL_MOB )
 		for( b = 0; b < bsize; b++ )
-			for( bl = mapdata->block[ b ]; bl != NULL; bl = bl->next )
+			for( bl = mapdata->block[ b ]; bl != NULL && !map_blocklist_done(bl, type); bl = bl->next )
 				if( bl->type&type && bl_list_count < BL_LIST_MAX )
 					bl_list[ bl_list_count++ ] = bl;
 
@@ -1681,6 +1736,8 @@ static int map_count_sub(struct block_list *bl,va_list ap)
 	return 1;
 }
 
+static int map_cellarea_scan(struct map_data *mapdata, int16 x0, int16 y0, int16 x1, int16 y1, cell_chk cellchk, bool count_all, int nth = -1, int16 *x = nullptr, int16 *y = nullptr);
+
 /*==========================================
  * Locates a random spare cell around the object given, using range as max
  * distance from that spot. Used for warping functions. Use range < 0 for
@@ -1730,6 +1787,34 @@ int map_search_freecell(struct block_list *src, int16 m, int16 *x,int16 *y, int1
 	if (rx >= 0 && ry >= 0) {
 		tries = rx2*ry2;
 		if (tries > 100) tries = 100;
+
+		if (mapdata->cellplane != nullptr) {
+			int reachable = map_cellarea_scan(mapdata, bx - rx, by - ry, bx + rx, by + ry, CELL_CHKREACH, true);
+			int free_cells = reachable;
+
+			if (map_getcellp(mapdata, bx, by, CELL_CHKREACH))
+				free_cells--; // Never pick the same target tile
+
+			if (free_cells <= 0) {
+				*x = bx;
+				*y = by;
+				return 0;
+			}
+
+			if (!(flag&(2|4))) {
+				// Nothing else to check, pick one of the reachable cells directly from the bitplane
+				while (tries--) {
+					map_cellarea_scan(mapdata, bx - rx, by - ry, bx + rx, by + ry, CELL_CHKREACH, true, rnd() % reachable, x, y);
+
+					if (*x != bx || *y != by)
+						return 1;
+				}
+
+				*x = bx;
+				*y = by;
+				return 0;
+			}
+		}
 	} else {
 		tries = mapdata->xs*mapdata->ys;
 		if (tries > 500) tries = 500;
@@ -2053,6 +2138,8 @@ void map_deliddb(struct block_list *bl)
 int map_quit(struct map_session_data *sd) {
 	int i;
 
+	clif_packet_capture_stop(sd->status.char_id);
+
 	if (sd->state.keepshop == false) { // Close vending/buyingstore
 		if (sd->state.vending)
 			vending_closevending(sd);
@@ -2410,6 +2497,18 @@ void map_foreachnpc(int (*func)(struct npc_data* nd, va_list args), ...)
 	dbi_destroy(iter);
 }
 
+/// Adds or removes bl from the objects processed by map_foreachregen.
+/// Removing the current object while iterating is allowed.
+void map_setregen(struct block_list* bl, bool active)
+{
+	nullpo_retv(bl);
+
+	if( active )
+		idb_put(regen_db, bl->id, bl);
+	else
+		idb_remove(regen_db, bl->id);
+}
+
 /// Applies func to everything in the db.
 /// Stops iterating if func returns -1.
 void map_foreachregen(int (*func)(struct block_list* bl, va_list args), ...)
@@ -2710,6 +2809,7 @@ int map_addinstancemap(int src_m, int instance_id, bool no_mapflag)
 	dst_map->iwall_num = src_map->iwall_num;
 
 	memset(dst_map->npc, 0, sizeof(dst_map->npc));
+	dst_map->npc_touch.clear();
 	dst_map->npc_num = 0;
 	dst_map->npc_num_area = 0;
 	dst_map->npc_num_warp = 0;
@@ -2719,11 +2819,13 @@ int map_addinstancemap(int src_m, int instance_id, bool no_mapflag)
 
 	CREATE( dst_map->cell, struct mapcell, num_cell );
 	memcpy( dst_map->cell, src_map->cell, num_cell * sizeof(struct mapcell) );
+	map_cellplane_init( dst_map );
 
 	size_t size = dst_map->bxs * dst_map->bys * sizeof(struct block_list*);
 
 	dst_map->block = (struct block_list **)aCalloc(1,size);
 	dst_map->block_mob = (struct block_list **)aCalloc(1,size);
+	dst_map->block_pc_last = (struct block_list **)aCalloc(1,size);
 
 	dst_map->index = mapindex_addmap(-1, dst_map->name);
 	dst_map->channel = nullptr;
@@ -2783,6 +2885,7 @@ static int map_instancemap_clean(struct block_list *bl, va_list ap)
 }
 
 static void map_free_questinfo(struct map_data *mapdata);
+static void map_cellplane_setbit(struct map_data *mapdata, e_cell_plane plane, int16 x, int16 y, bool flag);
 
 /*==========================================
  * Deleting an instance map
@@ -2808,14 +2911,20 @@ int map_delinstancemap(int m)
 	if (mapdata->cell)
 		aFree(mapdata->cell);
 	mapdata->cell = nullptr;
+	map_cellplane_free(mapdata);
+	path_hpa_invalidate(m);
 	if (mapdata->block)
 		aFree(mapdata->block);
 	mapdata->block = nullptr;
 	if (mapdata->block_mob)
 		aFree(mapdata->block_mob);
 	mapdata->block_mob = nullptr;
+	if (mapdata->block_pc_last)
+		aFree(mapdata->block_pc_last);
+	mapdata->block_pc_last = nullptr;
 
 	map_free_questinfo(mapdata);
+	mapdata->npc_touch.clear();
 	mapdata->damage_adjust = {};
 	mapdata->flag.clear();
 	mapdata->skill_damage.clear();
@@ -3257,13 +3366,32 @@ void map_setcell(int16 m, int16 x, int16 y, cell_t cell, bool flag)
 	j = x + y*mapdata->xs;
 
 	switch( cell ) {
-		case CELL_WALKABLE:      mapdata->cell[j].walkable = flag;      break;
-		case CELL_SHOOTABLE:     mapdata->cell[j].shootable = flag;     break;
-		case CELL_WATER:         mapdata->cell[j].water = flag;         break;
+		case CELL_WALKABLE:
+			mapdata->cell[j].walkable = flag;
+			map_cellplane_setbit(mapdata, CELLPLANE_WALKABLE, x, y, flag);
+			path_hpa_invalidate(m);
+			break;
+		case CELL_SHOOTABLE:
+			mapdata->cell[j].shootable = flag;
+			map_cellplane_setbit(mapdata, CELLPLANE_SHOOTABLE, x, y, flag);
+			break;
+		case CELL_WATER:
+			mapdata->cell[j].water = flag;
+			map_cellplane_setbit(mapdata, CELLPLANE_WATER, x, y, flag);
+			break;
 
-		case CELL_NPC:           mapdata->cell[j].npc = flag;           break;
-		case CELL_BASILICA:      mapdata->cell[j].basilica = flag;      break;
-		case CELL_LANDPROTECTOR: mapdata->cell[j].landprotector = flag; break;
+		case CELL_NPC:
+			mapdata->cell[j].npc = flag;
+			map_cellplane_setbit(mapdata, CELLPLANE_NPC, x, y, flag);
+			break;
+		case CELL_BASILICA:
+			mapdata->cell[j].basilica = flag;
+			map_cellplane_setbit(mapdata, CELLPLANE_BASILICA, x, y, flag);
+			break;
+		case CELL_LANDPROTECTOR:
+			mapdata->cell[j].landprotector = flag;
+			map_cellplane_setbit(mapdata, CELLPLANE_LANDPROTECTOR, x, y, flag);
+			break;
 		case CELL_NOVENDING:     mapdata->cell[j].novending = flag;     break;
 		case CELL_NOCHAT:        mapdata->cell[j].nochat = flag;        break;
 		case CELL_MAELSTROM:	 mapdata->cell[j].maelstrom = flag;	  break;
@@ -3290,6 +3418,253 @@ void map_setgatcell(int16 m, int16 x, int16 y, int gat)
 	mapdata->cell[j].walkable = cell.walkable;
 	mapdata->cell[j].shootable = cell.shootable;
 	mapdata->cell[j].water = cell.water;
+	map_cellplane_setbit(mapdata, CELLPLANE_WALKABLE, x, y, cell.walkable);
+	map_cellplane_setbit(mapdata, CELLPLANE_SHOOTABLE, x, y, cell.shootable);
+	map_cellplane_setbit(mapdata, CELLPLANE_WATER, x, y, cell.water);
+
+	path_hpa_invalidate(m);
+}
+
+/*==========================================
+ * Cell bitplanes
+ * Some cell flags are kept a second time as bitplanes of 64 cells per word.
+ * They are maintained by map_setcell/map_setgatcell and let area checks test
+ * a whole row segment per operation instead of decoding every single cell.
+ *------------------------------------------*/
+
+/// Amount of set bits in a word
+static inline int map_cellplane_popcount(uint64 word)
+{
+#if defined(__GNUC__)
+	return __builtin_popcountll(word);
+#else
+	int count = 0;
+
+	for (; word != 0; word &= word - 1)
+		count++;
+
+	return count;
+#endif
+}
+
+/// Index of the lowest set bit of a non-zero word
+static inline int map_cellplane_lowestbit(uint64 word)
+{
+#if defined(__GNUC__)
+	return __builtin_ctzll(word);
+#else
+	int bit = 0;
+
+	for (; !(word & 1); word >>= 1)
+		bit++;
+
+	return bit;
+#endif
+}
+
+static inline uint64 map_cellplane_getword(struct map_data *mapdata, e_cell_plane plane, int16 y, int16 w)
+{
+	return mapdata->cellplane[(plane * mapdata->ys + y) * mapdata->cellplane_words + w];
+}
+
+static void map_cellplane_setbit(struct map_data *mapdata, e_cell_plane plane, int16 x, int16 y, bool flag)
+{
+	if (mapdata->cellplane == nullptr)
+		return;
+
+	uint64 *word = &mapdata->cellplane[(plane * mapdata->ys + y) * mapdata->cellplane_words + x / 64];
+
+	if (flag)
+		*word |= (uint64)1 << (x % 64);
+	else
+		*word &= ~((uint64)1 << (x % 64));
+}
+
+/// Builds the bitplanes of a map from its cells
+void map_cellplane_init(struct map_data *mapdata)
+{
+	nullpo_retv(mapdata);
+
+	map_cellplane_free(mapdata);
+
+	if (mapdata->cell == nullptr)
+		return;
+
+	mapdata->cellplane_words = (mapdata->xs + 63) / 64;
+	CREATE(mapdata->cellplane, uint64, CELLPLANE_MAX * mapdata->ys * mapdata->cellplane_words);
+
+	for (int16 y = 0; y < mapdata->ys; y++) {
+		for (int16 x = 0; x < mapdata->xs; x++) {
+			const struct mapcell &cell = mapdata->cell[x + y * mapdata->xs];
+
+			map_cellplane_setbit(mapdata, CELLPLANE_WALKABLE, x, y, cell.walkable);
+			map_cellplane_setbit(mapdata, CELLPLANE_SHOOTABLE, x, y, cell.shootable);
+			map_cellplane_setbit(mapdata, CELLPLANE_WATER, x, y, cell.water);
+			map_cellplane_setbit(mapdata, CELLPLANE_NPC, x, y, cell.npc);
+			map_cellplane_setbit(mapdata, CELLPLANE_BASILICA, x, y, cell.basilica);
+			map_cellplane_setbit(mapdata, CELLPLANE_LANDPROTECTOR, x, y, cell.landprotector);
+		}
+	}
+}
+
+void map_cellplane_free(struct map_data *mapdata)
+{
+	nullpo_retv(mapdata);
+
+	if (mapdata->cellplane != nullptr)
+		aFree(mapdata->cellplane);
+	mapdata->cellplane = nullptr;
+	mapdata->cellplane_words = 0;
+}
+
+/// Combines the bitplanes of row y, cells 64*w to 64*w+63, into the result of 'cellchk'
+/// @return false if the check has no bitplane representation
+static bool map_cellplane_check(struct map_data *mapdata, cell_chk cellchk, int16 y, int16 w, uint64 &word)
+{
+	switch (cellchk) {
+		case CELL_CHKWALL:
+			word = ~map_cellplane_getword(mapdata, CELLPLANE_WALKABLE, y, w) & ~map_cellplane_getword(mapdata, CELLPLANE_SHOOTABLE, y, w);
+			return true;
+		case CELL_CHKCLIFF:
+			word = ~map_cellplane_getword(mapdata, CELLPLANE_WALKABLE, y, w) & map_cellplane_getword(mapdata, CELLPLANE_SHOOTABLE, y, w);
+			return true;
+		case CELL_CHKWATER:
+			word = map_cellplane_getword(mapdata, CELLPLANE_WATER, y, w);
+			return true;
+#ifndef CELL_NOSTACK
+		case CELL_CHKPASS:
+#endif
+		case CELL_CHKREACH:
+			word = map_cellplane_getword(mapdata, CELLPLANE_WALKABLE, y, w);
+			return true;
+#ifndef CELL_NOSTACK
+		case CELL_CHKNOPASS:
+#endif
+		case CELL_CHKNOREACH:
+			word = ~map_cellplane_getword(mapdata, CELLPLANE_WALKABLE, y, w);
+			return true;
+		case CELL_CHKNPC:
+			word = map_cellplane_getword(mapdata, CELLPLANE_NPC, y, w);
+			return true;
+		case CELL_CHKBASILICA:
+			word = map_cellplane_getword(mapdata, CELLPLANE_BASILICA, y, w);
+			return true;
+		case CELL_CHKLANDPROTECTOR:
+			word = map_cellplane_getword(mapdata, CELLPLANE_LANDPROTECTOR, y, w);
+			return true;
+		default:
+			return false;
+	}
+}
+
+/**
+ * Scans the area (x0,y0)-(x1,y1) for cells matching 'cellchk', with the same results as map_getcellp
+ * @param mapdata: Map to scan
+ * @param cellchk: Cell check
+ * @param count_all: Count all matching cells instead of stopping at the first one
+ * @param nth: If not negative, stop at the nth matching cell (0 based) and store its position in x/y
+ * @return Amount of matching cells found
+ */
+static int map_cellarea_scan(struct map_data *mapdata, int16 x0, int16 y0, int16 x1, int16 y1, cell_chk cellchk, bool count_all, int nth, int16 *x, int16 *y)
+{
+	if (mapdata == nullptr || mapdata->cell == nullptr)
+		return 0;
+
+	if (x0 > x1)
+		SWAP(x0, x1);
+	if (y0 > y1)
+		SWAP(y0, y1);
+
+	// NOTE: map_getcellp intentionally overrides the last row and column
+	int16 cx0 = i16max(x0, 0), cy0 = i16max(y0, 0);
+	int16 cx1 = i16min(x1, mapdata->xs - 2), cy1 = i16min(y1, mapdata->ys - 2);
+	int count = 0;
+
+	if (cellchk == CELL_CHKNOPASS && nth < 0) {
+		int inside = (cx0 <= cx1 && cy0 <= cy1) ? (cx1 - cx0 + 1) * (cy1 - cy0 + 1) : 0;
+		int outside = (x1 - x0 + 1) * (y1 - y0 + 1) - inside;
+
+		if (outside > 0) {
+			if (!count_all)
+				return 1;
+			count += outside;
+		}
+	}
+
+	if (cx0 > cx1 || cy0 > cy1)
+		return count;
+
+	uint64 word;
+
+	if (mapdata->cellplane == nullptr || !map_cellplane_check(mapdata, cellchk, cy0, cx0 / 64, word)) {
+		// No bitplane for this check, test every cell
+		for (int16 cy = cy0; cy <= cy1; cy++) {
+			for (int16 cx = cx0; cx <= cx1; cx++) {
+				if (!map_getcellp(mapdata, cx, cy, cellchk))
+					continue;
+				if (count == nth) {
+					*x = cx;
+					*y = cy;
+					return count + 1;
+				}
+				count++;
+				if (!count_all)
+					return count;
+			}
+		}
+
+		return count;
+	}
+
+	int16 w0 = cx0 / 64, w1 = cx1 / 64;
+
+	for (int16 cy = cy0; cy <= cy1; cy++) {
+		for (int16 w = w0; w <= w1; w++) {
+			map_cellplane_check(mapdata, cellchk, cy, w, word);
+
+			if (w == w0)
+				word &= ~(uint64)0 << (cx0 % 64);
+			if (w == w1)
+				word &= ~(uint64)0 >> (63 - cx1 % 64);
+
+			if (word == 0)
+				continue;
+
+			int bits = map_cellplane_popcount(word);
+
+			if (nth >= 0 && nth < count + bits) {
+				for (int skip = nth - count; skip > 0; skip--)
+					word &= word - 1; // Clear the lowest set bit
+
+				*x = w * 64 + map_cellplane_lowestbit(word);
+				*y = cy;
+				return nth + 1;
+			}
+
+			count += bits;
+
+			if (!count_all)
+				return count;
+		}
+	}
+
+	return count;
+}
+
+/*==========================================
+ * Whether any cell of the area (x0,y0)-(x1,y1) matches 'cellchk'
+ *------------------------------------------*/
+int map_getcellarea(int16 m, int16 x0, int16 y0, int16 x1, int16 y1, cell_chk cellchk)
+{
+	return (map_cellarea_scan(map_getmapdata(m), x0, y0, x1, y1, cellchk, false) > 0);
+}
+
+/*==========================================
+ * Amount of cells of the area (x0,y0)-(x1,y1) that match 'cellchk'
+ *------------------------------------------*/
+int map_countcellarea(int16 m, int16 x0, int16 y0, int16 x1, int16 y1, cell_chk cellchk)
+{
+	return map_cellarea_scan(map_getmapdata(m), x0, y0, x1, y1, cellchk, true);
 }
 
 /*==========================================
@@ -3849,10 +4224,13 @@ int map_readallmaps (void)
 		size = mapdata->bxs * mapdata->bys * sizeof(struct block_list*);
 		mapdata->block = (struct block_list**)aCalloc(size, 1);
 		mapdata->block_mob = (struct block_list**)aCalloc(size, 1);
+		mapdata->block_pc_last = (struct block_list**)aCalloc(size, 1);
 
 		memset(&mapdata->save, 0, sizeof(struct point));
 		mapdata->damage_adjust = {};
 		mapdata->channel = NULL;
+
+		map_cellplane_init(mapdata);
 	}
 
 	// intialization and configuration-dependent adjustments of mapflags
@@ -3942,12 +4320,83 @@ int parse_console(const char* buf){
 	else if( strcmpi("ers_report", type) == 0 ){
 		ers_report();
 	}
+	else if( strcmpi("autosave_report", type) == 0 ){
+		pc_autosave_report();
+	}
+	else if( n == 2 && strcmpi("packet_metrics", type) == 0 ){
+		if( strcmpi("on", command) == 0 )
+			packet_metrics_enable(true);
+		else if( strcmpi("off", command) == 0 )
+			packet_metrics_enable(false);
+		else if( strcmpi("reset", command) == 0 )
+			packet_metrics_reset();
+		else if( strncmpi("report", command, 6) == 0 )
+			packet_metrics_report(strtoul(command + 6, nullptr, 10));
+		else
+			ShowInfo("Console: Usage packet_metrics:on|off|reset|report [limit]\n");
+	}
+	else if( n == 2 && strcmpi("tick_metrics", type) == 0 ){
+		tick_metrics_console(command);
+	}
+	else if( n >= 2 && strcmpi("packet_capture", type) == 0 ){
+		char action[16], file[256];
+		uint32 char_id;
+		// Read the arguments from the raw line, command is cut at the next ':' of a path such as C:\captures
+		int args = sscanf(strchr(buf, ':') + 1, "%15s %11u %255s", action, &char_id, file);
+
+		if( args == 3 && strcmpi("start", action) == 0 ){
+			if( clif_packet_capture_start(char_id, file) )
+				ShowInfo("Console: Capturing the packets of character %u to '%s'.\n", char_id, file);
+		}
+		else if( args >= 2 && strcmpi("stop", action) == 0 ){
+			if( clif_packet_capture_stop(char_id) )
+				ShowInfo("Console: Stopped capturing the packets of character %u.\n", char_id);
+			else
+				ShowWarning("Console: The packets of character %u are not captured.\n", char_id);
+		}
+		else
+			ShowInfo("Console: Usage packet_capture:start <char id> <file> | packet_capture:stop <char id>\n");
+	}
+	else if( n >= 2 && strcmpi("packet_replay", type) == 0 ){
+		char file[256];
+		uint32 char_id;
+		int repeat = 1;
+		map_session_data* tsd;
+
+		// Same as packet_capture, the file path may contain ':'
+		if( sscanf(strchr(buf, ':') + 1, "%11u %255s %11d", &char_id, file, &repeat) < 2 )
+			ShowInfo("Console: Usage packet_replay:<char id> <file> [repeat]\n");
+		else if( ( tsd = map_charid2sd(char_id) ) == nullptr )
+			ShowWarning("Console: Character %u is not online.\n", char_id);
+		else
+			clif_packet_replay(tsd, file, max(repeat, 1));
+	}
+	else if( n == 2 && strcmpi("battle_bench", type) == 0 ){
+		uint32 char_id, seed = 1;
+		unsigned short mob_id, skill_id, skill_lv;
+		int iterations;
+		map_session_data* tsd;
+
+		if( sscanf(command, "%11u %5hu %5hu %5hu %11d %11u", &char_id, &mob_id, &skill_id, &skill_lv, &iterations, &seed) < 5 )
+			ShowInfo("Console: Usage battle_bench:<char id> <mob id> <skill id> <skill lv> <iterations> [seed]\n");
+		else if( ( tsd = map_charid2sd(char_id) ) == nullptr || tsd->bl.prev == nullptr )
+			ShowWarning("Console: Character %u is not online.\n", char_id);
+		else
+			battle_calc_benchmark(tsd, mob_id, skill_id, skill_lv, max(iterations, 1), seed);
+	}
 	else if( strcmpi("help", type) == 0 ) {
 		ShowInfo("Available commands:\n");
 		ShowInfo("\t admin:@<atcommand> => Uses an atcommand. Do NOT use commands requiring an attached player.\n");
 		ShowInfo("\t admin:map:<map> <x> <y> => Changes the map from which console commands are executed.\n");
 		ShowInfo("\t server:shutdown => Stops the server.\n");
 		ShowInfo("\t ers_report => Displays database usage.\n");
+		ShowInfo("\t autosave_report => Displays the autosave queues.\n");
+		ShowInfo("\t packet_metrics:on|off|reset|report [limit] => Collects and displays per-opcode packet statistics.\n");
+		ShowInfo("\t tick_metrics:on|off|reset|report [limit]|slow <ms>|export <file> => Times the main loop phases and timer functions.\n");
+		ShowInfo("\t packet_capture:start <char id> <file> => Records the packets sent by a character.\n");
+		ShowInfo("\t packet_capture:stop <char id> => Stops recording the packets of a character.\n");
+		ShowInfo("\t packet_replay:<char id> <file> [repeat] => Replays recorded packets for an online character and shows the throughput.\n");
+		ShowInfo("\t battle_bench:<char id> <mob id> <skill id> <skill lv> <iterations> [seed] => Benchmarks the damage calculation of a character against a monster.\n");
 	}
 
 	return 0;
@@ -4026,7 +4475,11 @@ int map_config_read(const char *cfgName)
 			minsave_interval= atoi(w2);
 			if (minsave_interval < 1)
 				minsave_interval = 1;
-		} else if (strcmpi(w1, "save_settings") == 0)
+		} else if (strcmpi(w1, "autosave_budget") == 0)
+			autosave_budget = max(0, atoi(w2));
+		else if (strcmpi(w1, "autosave_priority_zeny") == 0)
+			autosave_priority_zeny = max(0, atoi(w2));
+		else if (strcmpi(w1, "save_settings") == 0)
 			save_settings = cap_value(atoi(w2),CHARSAVE_NONE,CHARSAVE_ALL);
 		else if (strcmpi(w1, "motd_txt") == 0)
 			safestrncpy(motd_txt, w2, sizeof(motd_txt));
@@ -4906,6 +5359,7 @@ void do_final(void){
 	do_final_channel(); //should be called after final guild
 	do_final_vending();
 	do_final_buyingstore();
+	do_final_searchstore();
 	do_final_path();
 
 	map_db->destroy(map_db, map_db_final);
@@ -4914,8 +5368,10 @@ void do_final(void){
 		struct map_data *mapdata = map_getmapdata(i);
 
 		if(mapdata->cell) aFree(mapdata->cell);
+		map_cellplane_free(mapdata);
 		if(mapdata->block) aFree(mapdata->block);
 		if(mapdata->block_mob) aFree(mapdata->block_mob);
+		if(mapdata->block_pc_last) aFree(mapdata->block_pc_last);
 		if(battle_config.dynamic_mobs) { //Dynamic mobs flag by [random]
 			if(mapdata->mob_delete_timer != INVALID_TIMER)
 				delete_timer(mapdata->mob_delete_timer, map_removemobs_timer);
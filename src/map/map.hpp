@@ -765,6 +765,17 @@ struct mapcell
 #endif
 };
 
+// Cell flags that are additionally kept as bitplanes of 64 cells per word, for fast area checks
+enum e_cell_plane : uint8 {
+	CELLPLANE_WALKABLE = 0,
+	CELLPLANE_SHOOTABLE,
+	CELLPLANE_WATER,
+	CELLPLANE_NPC,
+	CELLPLANE_BASILICA,
+	CELLPLANE_LANDPROTECTOR,
+	CELLPLANE_MAX
+};
+
 struct iwall_data {
 	char wall_name[50];
 	short m, x, y, size;
@@ -776,8 +787,11 @@ struct map_data {
 	char name[MAP_NAME_LENGTH];
 	uint16 index; // The map index used by the mapindex* functions.
 	struct mapcell* cell; // Holds the information of each map cell (NULL if the map is not on this map-server).
-	struct block_list **block;
+	uint64* cellplane; // Bitplanes of the cell flags, see e_cell_plane (row y of plane p starts at word (p*ys+y)*cellplane_words)
+	int16 cellplane_words; // Amount of 64bit words per bitplane row
+	struct block_list **block; // Players are kept in front of all other objects, see map_addblock
 	struct block_list **block_mob;
+	struct block_list **block_pc_last; // Last player of each block list
 	int16 m;
 	int16 xs,ys; // map dimensions (in cells)
 	int16 bxs,bys; // map dimensions (in blocks)
@@ -798,6 +812,7 @@ struct map_data {
 	std::unordered_map<uint16, int> skill_duration;
 
 	struct npc_data *npc[MAX_NPC_PER_MAP];
+	std::vector<std::vector<struct npc_data*>> npc_touch; // Warps and OnTouch NPCs whose trigger area overlaps each block of cells, see npc_touch_index_add
 	struct spawn_data *moblist[MAX_MOB_LIST_PER_MAP]; // [Wizputer]
 	int mob_delete_timer;	// Timer ID for map_removemobs_timer [Skotlex]
 
@@ -844,12 +859,18 @@ int map_getcell(int16 m,int16 x,int16 y,cell_chk cellchk);
 int map_getcellp(struct map_data* m,int16 x,int16 y,cell_chk cellchk);
 void map_setcell(int16 m, int16 x, int16 y, cell_t cell, bool flag);
 void map_setgatcell(int16 m, int16 x, int16 y, int gat);
+int map_getcellarea(int16 m, int16 x0, int16 y0, int16 x1, int16 y1, cell_chk cellchk);
+int map_countcellarea(int16 m, int16 x0, int16 y0, int16 x1, int16 y1, cell_chk cellchk);
+void map_cellplane_init(struct map_data *mapdata);
+void map_cellplane_free(struct map_data *mapdata);
 
 extern struct map_data map[];
 extern int map_num;
 
 extern int autosave_interval;
 extern int minsave_interval;
+extern int autosave_budget;
+extern int autosave_priority_zeny;
 extern int16 save_settings;
 extern int night_flag; // 0=day, 1=night [Yor]
 extern int enable_spy; //Determines if @spy commands are active.
@@ -1141,6 +1162,7 @@ void map_foreachpc(int (*func)(struct map_session_data* sd, va_list args), ...);
 void map_foreachmob(int (*func)(struct mob_data* md, va_list args), ...);
 void map_foreachnpc(int (*func)(struct npc_data* nd, va_list args), ...);
 void map_foreachregen(int (*func)(struct block_list* bl, va_list args), ...);
+void map_setregen(struct block_list* bl, bool active);
 void map_foreachiddb(int (*func)(struct block_list* bl, va_list args), ...);
 struct map_session_data * map_nick2sd(const char* nick, bool allow_partial);
 struct mob_data * map_getmob_boss(int16 m);
@@ -4,6 +4,9 @@
 #include "mapreg.hpp"
 
 #include <stdlib.h>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
 
 #include "../common/cbasetypes.hpp"
 #include "../common/db.hpp"
@@ -22,10 +25,28 @@ static struct eri *mapreg_ers;
 bool skip_insert = false;
 
 static char mapreg_table[32] = "mapreg";
-static bool mapreg_dirty = false; // Whether there are modified regs to be saved
+static std::unordered_set<int64> mapreg_dirty; // uids of the permanent variables that changed since the last flush
 struct reg_db regs;
 
-#define MAPREG_AUTOSAVE_INTERVAL (300*1000)
+#define MAPREG_FLUSH_INTERVAL 1000 // Interval of the dirty variable flush [ms]
+#define MAPREG_FLUSH_LIMIT 2000 // Max variables written per timed flush, the rest waits for the next one
+#define MAPREG_FLUSH_ROWS 500 // Max rows per INSERT statement
+
+/**
+ * Marks a permanent variable to be written to the database on the next flush.
+ * Inserts, updates and deletes are all deferred; the flush writes whatever the
+ * variable holds at that point.
+ *
+ * @param uid: variable's unique identifier
+ * @param name: variable's name
+ */
+static void mapreg_setdirty(int64 uid, const char* name)
+{
+	if (name[1] == '@' || skip_insert)
+		return;
+
+	mapreg_dirty.insert(uid);
+}
 
 
 /**
@@ -69,10 +90,6 @@ bool mapreg_setreg(int64 uid, int64 val)
 	if (val != 0) {
 		if ((m = static_cast<mapreg_save *>(i64db_get(regs.vars, uid)))) {
 			m->u.i = val;
-			if (name[1] != '@') {
-				m->save = true;
-				mapreg_dirty = true;
-			}
 		} else {
 			if (i)
 				script_array_update(&regs, uid, false);
@@ -81,15 +98,8 @@ bool mapreg_setreg(int64 uid, int64 val)
 
 			m->u.i = val;
 			m->uid = uid;
-			m->save = false;
 			m->is_string = false;
 
-			if (name[1] != '@' && !skip_insert) {// write new variable to database
-				char esc_name[32 * 2 + 1];
-				Sql_EscapeStringLen(mmysql_handle, esc_name, name, strnlen(name, 32));
-				if (SQL_ERROR == Sql_Query(mmysql_handle, "INSERT INTO `%s`(`varname`,`index`,`value`) VALUES ('%s','%" PRIu32 "','%" PRId64 "')", mapreg_table, esc_name, i, val))
-					Sql_ShowDebug(mmysql_handle);
-			}
 			i64db_put(regs.vars, uid, m);
 		}
 	} else { // val == 0
@@ -99,15 +109,11 @@ bool mapreg_setreg(int64 uid, int64 val)
 			ers_free(mapreg_ers, m);
 		}
 		i64db_remove(regs.vars, uid);
-
-		if (name[1] != '@') {// Remove from database because it is unused.
-			char esc_name[32 * 2 + 1];
-			Sql_EscapeStringLen(mmysql_handle, esc_name, name, strnlen(name, 32));
-			if (SQL_ERROR == Sql_Query(mmysql_handle, "DELETE FROM `%s` WHERE `varname`='%s' AND `index`='%" PRIu32 "'", mapreg_table, esc_name, i))
-				Sql_ShowDebug(mmysql_handle);
-		}
 	}
 
+	// Removed variables are deleted from the database on flush because they are unused.
+	mapreg_setdirty(uid, name);
+
 	return true;
 }
 
@@ -128,12 +134,6 @@ bool mapreg_setregstr(int64 uid, const char* str)
 	if (str == NULL || *str == 0) {
 		if (i)
 			script_array_update(&regs, uid, true);
-		if (name[1] != '@') {
-			char esc_name[32 * 2 + 1];
-			Sql_EscapeStringLen(mmysql_handle, esc_name, name, strnlen(name, 32));
-			if (SQL_ERROR == Sql_Query(mmysql_handle, "DELETE FROM `%s` WHERE `varname`='%s' AND `index`='%" PRIu32 "'", mapreg_table, esc_name, i))
-				Sql_ShowDebug(mmysql_handle);
-		}
 		if ((m = static_cast<mapreg_save *>(i64db_get(regs.vars, uid)))) {
 			if (m->u.str != NULL)
 				aFree(m->u.str);
@@ -145,10 +145,6 @@ bool mapreg_setregstr(int64 uid, const char* str)
 			if (m->u.str != NULL)
 				aFree(m->u.str);
 			m->u.str = aStrdup(str);
-			if (name[1] != '@') {
-				mapreg_dirty = true;
-				m->save = true;
-			}
 		} else {
 			if (i)
 				script_array_update(&regs, uid, false);
@@ -157,21 +153,14 @@ bool mapreg_setregstr(int64 uid, const char* str)
 
 			m->uid = uid;
 			m->u.str = aStrdup(str);
-			m->save = false;
 			m->is_string = true;
 
-			if (name[1] != '@' && !skip_insert) { //put returned null, so we must insert.
-				char esc_name[32 * 2 + 1];
-				char esc_str[255 * 2 + 1];
-				Sql_EscapeStringLen(mmysql_handle, esc_name, name, strnlen(name, 32));
-				Sql_EscapeStringLen(mmysql_handle, esc_str, str, strnlen(str, 255));
-				if (SQL_ERROR == Sql_Query(mmysql_handle, "INSERT INTO `%s`(`varname`,`index`,`value`) VALUES ('%s','%" PRIu32 "','%s')", mapreg_table, esc_name, i, esc_str))
-					Sql_ShowDebug(mmysql_handle);
-			}
 			i64db_put(regs.vars, uid, m);
 		}
 	}
 
+	mapreg_setdirty(uid, name);
+
 	return true;
 }
 
@@ -224,48 +213,99 @@ static void script_load_mapreg(void)
 	SqlStmt_Free(stmt);
 
 	skip_insert = false;
-	mapreg_dirty = false;
 }
 
 /**
- * Saves permanent variables to database.
+ * Writes the dirty permanent variables to the database.
+ * Current values are upserted with multi-row statements, removed variables are
+ * deleted with one statement per variable name, so arrays go out in one batch.
+ *
+ * @param limit: max amount of variables to write, 0 for all of them
  */
-static void script_save_mapreg(void)
+static void script_save_mapreg(size_t limit)
 {
-	if (mapreg_dirty) {
-		DBIterator *iter = db_iterator(regs.vars);
-		struct mapreg_save *m;
-		for (m = static_cast<mapreg_save *>(dbi_first(iter)); dbi_exists(iter); m = static_cast<mapreg_save *>(dbi_next(iter))) {
-			if (m->save) {
-				int num = script_getvarid(m->uid);
-				uint32 i = script_getvaridx(m->uid);
-				const char* name = get_str(num);
-				if (!m->is_string) {
-					char esc_name[32 * 2 + 1];
-					Sql_EscapeStringLen(mmysql_handle, esc_name, name, strnlen(name, 32));
-					if (SQL_ERROR == Sql_Query(mmysql_handle, "UPDATE `%s` SET `value`='%" PRId64 "' WHERE `varname`='%s' AND `index`='%" PRIu32 "' LIMIT 1", mapreg_table, m->u.i, esc_name, i))
-						Sql_ShowDebug(mmysql_handle);
-				} else {
-					char esc_str[2 * 255 + 1];
-					char esc_name[32 * 2 + 1];
-					Sql_EscapeStringLen(mmysql_handle, esc_name, name, strnlen(name, 32));
-					Sql_EscapeStringLen(mmysql_handle, esc_str, m->u.str, safestrnlen(m->u.str, 255));
-					if (SQL_ERROR == Sql_Query(mmysql_handle, "UPDATE `%s` SET `value`='%s' WHERE `varname`='%s' AND `index`='%" PRIu32 "' LIMIT 1", mapreg_table, esc_str, esc_name, i))
-						Sql_ShowDebug(mmysql_handle);
-				}
-				m->save = false;
-			}
+	if (mapreg_dirty.empty())
+		return;
+
+	std::unordered_map<int, std::vector<uint32>> deleted; // variable name id -> removed indexes
+	StringBuf buf;
+	int rows = 0;
+	size_t count = 0;
+
+	StringBuf_Init(&buf);
+
+	for (auto it = mapreg_dirty.begin(); it != mapreg_dirty.end() && (limit == 0 || count < limit); count++) {
+		int64 uid = *it;
+		int num = script_getvarid(uid);
+		uint32 i = script_getvaridx(uid);
+		struct mapreg_save *m = static_cast<mapreg_save *>(i64db_get(regs.vars, uid));
+
+		it = mapreg_dirty.erase(it);
+
+		if (m == nullptr) {
+			deleted[num].push_back(i);
+			continue;
 		}
-		dbi_destroy(iter);
-		mapreg_dirty = false;
+
+		const char* name = get_str(num);
+		char esc_name[32 * 2 + 1];
+
+		Sql_EscapeStringLen(mmysql_handle, esc_name, name, strnlen(name, 32));
+
+		if (rows == 0)
+			StringBuf_Printf(&buf, "INSERT INTO `%s`(`varname`,`index`,`value`) VALUES ", mapreg_table);
+		else
+			StringBuf_AppendStr(&buf, ",");
+
+		if (!m->is_string) {
+			StringBuf_Printf(&buf, "('%s','%" PRIu32 "','%" PRId64 "')", esc_name, i, m->u.i);
+		} else {
+			char esc_str[2 * 255 + 1];
+
+			Sql_EscapeStringLen(mmysql_handle, esc_str, m->u.str, safestrnlen(m->u.str, 255));
+			StringBuf_Printf(&buf, "('%s','%" PRIu32 "','%s')", esc_name, i, esc_str);
+		}
+
+		if (++rows == MAPREG_FLUSH_ROWS) {
+			StringBuf_AppendStr(&buf, " ON DUPLICATE KEY UPDATE `value`=VALUES(`value`)");
+			if (SQL_ERROR == Sql_QueryStr(mmysql_handle, StringBuf_Value(&buf)))
+				Sql_ShowDebug(mmysql_handle);
+			StringBuf_Clear(&buf);
+			rows = 0;
+		}
+	}
+
+	if (rows > 0) {
+		StringBuf_AppendStr(&buf, " ON DUPLICATE KEY UPDATE `value`=VALUES(`value`)");
+		if (SQL_ERROR == Sql_QueryStr(mmysql_handle, StringBuf_Value(&buf)))
+			Sql_ShowDebug(mmysql_handle);
+	}
+
+	for (const auto &var : deleted) {
+		const char* name = get_str(var.first);
+		char esc_name[32 * 2 + 1];
+
+		Sql_EscapeStringLen(mmysql_handle, esc_name, name, strnlen(name, 32));
+		StringBuf_Clear(&buf);
+		StringBuf_Printf(&buf, "DELETE FROM `%s` WHERE `varname`='%s' AND `index` IN (", mapreg_table, esc_name);
+
+		for (size_t j = 0; j < var.second.size(); j++)
+			StringBuf_Printf(&buf, j ? ",'%" PRIu32 "'" : "'%" PRIu32 "'", var.second[j]);
+
+		StringBuf_AppendStr(&buf, ")");
+
+		if (SQL_ERROR == Sql_QueryStr(mmysql_handle, StringBuf_Value(&buf)))
+			Sql_ShowDebug(mmysql_handle);
 	}
+
+	StringBuf_Destroy(&buf);
 }
 
 /**
- * Timer event to auto-save permanent variables.
+ * Timer event to flush modified permanent variables.
  */
 static TIMER_FUNC(script_autosave_mapreg){
-	script_save_mapreg();
+	script_save_mapreg(MAPREG_FLUSH_LIMIT);
 	return 0;
 }
 
@@ -300,7 +340,7 @@ int mapreg_destroyreg(DBKey key, DBData *data, va_list ap)
  */
 void mapreg_reload(void)
 {
-	script_save_mapreg();
+	script_save_mapreg(0);
 
 	regs.vars->clear(regs.vars, mapreg_destroyreg);
 
@@ -317,7 +357,7 @@ void mapreg_reload(void)
  */
 void mapreg_final(void)
 {
-	script_save_mapreg();
+	script_save_mapreg(0);
 
 	regs.vars->destroy(regs.vars, mapreg_destroyreg);
 
@@ -341,7 +381,7 @@ void mapreg_init(void)
 	script_load_mapreg();
 
 	add_timer_func_list(script_autosave_mapreg, "script_autosave_mapreg");
-	add_timer_interval(gettick() + MAPREG_AUTOSAVE_INTERVAL, script_autosave_mapreg, 0, 0, MAPREG_AUTOSAVE_INTERVAL);
+	add_timer_interval(gettick() + MAPREG_FLUSH_INTERVAL, script_autosave_mapreg, 0, 0, MAPREG_FLUSH_INTERVAL);
 }
 
 /**
@@ -14,7 +14,6 @@ struct mapreg_save {
 		char *str;     ///< String value
 	} u;
 	bool is_string;    ///< true if it's a string, false if it's a number
-	bool save;         ///< Whether a save operation is pending
 };
 
 extern struct reg_db regs;
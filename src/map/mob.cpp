@@ -290,8 +290,11 @@ static bool mobdb_searchname_sub(uint16 mob_id, const char * const str, bool ful
 */
 uint16 mobdb_searchname_(const char * const str, bool full_cmp)
 {
-	for( auto const &mobdb_pair : mob_db ) {
-		const uint16 mob_id = mobdb_pair.first;
+	std::vector<uint32> matches;
+
+	mob_db.searchname(str, full_cmp, matches);
+
+	for( const uint32 &mob_id : matches ) {
 		if( mobdb_searchname_sub(mob_id, str, full_cmp) )
 			return mob_id;
 	}
@@ -319,14 +322,14 @@ std::shared_ptr<s_mob_db> mobdb_search_aegisname( const char* str ){
 uint16 mobdb_searchname_array_(const char *str, uint16 * out, uint16 size, bool full_cmp)
 {
 	uint16 count = 0;
-	const auto &mob_list = mob_db.getCache();
+	std::vector<uint32> matches;
 
-	for( const auto &mob : mob_list ) {
-		if (mob == nullptr)
-			continue;
-		if( mobdb_searchname_sub(mob->id, str, full_cmp) ) {
+	mob_db.searchname(str, full_cmp, matches);
+
+	for( const uint32 &mob_id : matches ) {
+		if( mobdb_searchname_sub(mob_id, str, full_cmp) ) {
 			if( count < size )
-				out[count] = mob->id;
+				out[count] = mob_id;
 			count++;
 		}
 	}
@@ -5020,9 +5023,32 @@ void MobDatabase::loadingFinished() {
 		mob->status.sp = mob->status.max_sp;
 	}
 
+	this->nameIndex.clear();
+
+	for (const auto &mobdata : *this) {
+		this->nameIndex.add(mobdata.second->name, mobdata.first);
+		this->nameIndex.add(mobdata.second->jname, mobdata.first);
+		this->nameIndex.add(mobdata.second->sprite, mobdata.first);
+	}
+
+	this->nameIndex.build();
+
 	TypesafeCachedYamlDatabase::loadingFinished();
 }
 
+/**
+ * Finds all monsters by name, japanese name or sprite name
+ * @param str: Name to look for (case insensitive)
+ * @param full_cmp: Whether the names must be equal to str or only contain it
+ * @param out: Matching monster IDs in ascending order
+ */
+void MobDatabase::searchname( const char* str, bool full_cmp, std::vector<uint32>& out ){
+	if( full_cmp )
+		this->nameIndex.find_exact( str, out );
+	else
+		this->nameIndex.find_substring( str, out );
+}
+
 MobDatabase mob_db;
 
 /**
@@ -273,6 +273,8 @@ struct s_mob_db {
 
 class MobDatabase : public TypesafeCachedYamlDatabase <uint32, s_mob_db> {
 private:
+	rathena::util::name_index nameIndex; // Name, japanese name and sprite name for name searches
+
 	bool parseDropNode(std::string nodeName, const ryml::NodeRef& node, uint8 max, s_mob_drop *drops);
 
 public:
@@ -283,6 +285,14 @@ public:
 	const std::string getDefaultLocation() override;
 	uint64 parseBodyNode(const ryml::NodeRef& node) override;
 	void loadingFinished() override;
+	void clear() override{
+		TypesafeCachedYamlDatabase::clear();
+
+		this->nameIndex.clear();
+	}
+
+	// Additional
+	void searchname( const char* str, bool full_cmp, std::vector<uint32>& out );
 };
 
 extern MobDatabase mob_db;
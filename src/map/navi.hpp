@@ -29,15 +29,6 @@ struct navi_link {
 };
 
 
-// We need a bigger max path length than stock walkpath
-#define MAX_WALKPATH_NAVI 1024
-
-struct navi_walkpath_data {
-	uint8 path_len, path_pos;
-	uint8 path[MAX_WALKPATH_NAVI];
-};
-
-
 void navi_create_lists();
 #endif // ifdef MAP_GENERATOR
 #endif
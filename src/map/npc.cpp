@@ -1758,6 +1758,87 @@ int npc_event(struct map_session_data* sd, const char* eventname, int ontouch)
 	return 0;
 }
 
+/// Size of the cell blocks of the OnTouch area index
+#define NPC_TOUCH_BLOCK_SIZE 8
+
+/**
+ * Gets the trigger area of a warp or OnTouch NPC.
+ * @param nd: NPC data
+ * @param xs: Horizontal range of the area
+ * @param ys: Vertical range of the area
+ * @return True if the NPC has a trigger area, false otherwise
+ */
+static bool npc_touch_getarea(struct npc_data* nd, int16& xs, int16& ys)
+{
+	switch (nd->subtype) {
+	case NPCTYPE_WARP:
+		xs = nd->u.warp.xs;
+		ys = nd->u.warp.ys;
+		break;
+	case NPCTYPE_SCRIPT:
+		xs = nd->u.scr.xs;
+		ys = nd->u.scr.ys;
+		break;
+	default:
+		return false;
+	}
+
+	return nd->bl.m >= 0 && xs >= 0 && ys >= 0;
+}
+
+/**
+ * Gets the block of the OnTouch area index that contains a cell.
+ * @param mapdata: Map data
+ * @param x: X coordinate
+ * @param y: Y coordinate
+ * @return Index into map_data::npc_touch
+ */
+static inline size_t npc_touch_block(struct map_data* mapdata, int16 x, int16 y)
+{
+	return x / NPC_TOUCH_BLOCK_SIZE + (y / NPC_TOUCH_BLOCK_SIZE) * ((mapdata->xs + NPC_TOUCH_BLOCK_SIZE - 1) / NPC_TOUCH_BLOCK_SIZE);
+}
+
+/**
+ * Adds or removes a NPC in every block of the OnTouch area index its trigger area overlaps.
+ * Warps are kept in front of OnTouch NPCs, as they have to be checked first.
+ * @param nd: NPC data
+ * @param add: True to add the NPC, false to remove it
+ */
+static void npc_touch_index_update(struct npc_data* nd, bool add)
+{
+	int16 xs, ys;
+
+	if (!npc_touch_getarea(nd, xs, ys))
+		return;
+
+	struct map_data *mapdata = map_getmapdata(nd->bl.m);
+
+	if (mapdata->npc_touch.empty()) {
+		if (!add)
+			return;
+
+		mapdata->npc_touch.resize(npc_touch_block(mapdata, mapdata->xs - 1, mapdata->ys - 1) + 1);
+	}
+
+	int16 x0 = i16max(nd->bl.x - xs, 0), y0 = i16max(nd->bl.y - ys, 0);
+	int16 x1 = i16min(nd->bl.x + xs, mapdata->xs - 1), y1 = i16min(nd->bl.y + ys, mapdata->ys - 1);
+
+	for (int16 y = y0 - y0 % NPC_TOUCH_BLOCK_SIZE; y <= y1; y += NPC_TOUCH_BLOCK_SIZE) {
+		for (int16 x = x0 - x0 % NPC_TOUCH_BLOCK_SIZE; x <= x1; x += NPC_TOUCH_BLOCK_SIZE) {
+			std::vector<struct npc_data*> &list = mapdata->npc_touch[npc_touch_block(mapdata, x, y)];
+
+			if (!add)
+				util::vector_erase_if_exists(list, nd);
+			else if (util::vector_exists(list, nd))
+				continue;
+			else if (nd->subtype == NPCTYPE_WARP)
+				list.insert(std::find_if(list.begin(), list.end(), [](struct npc_data* other) { return other->subtype != NPCTYPE_WARP; }), nd);
+			else
+				list.push_back(nd);
+		}
+	}
+}
+
 /*==========================================
  * Sub chk then execute area event type
  *------------------------------------------*/
@@ -1903,10 +1984,12 @@ int npc_touch_area_allnpc(struct map_session_data* sd, int16 m, int16 x, int16 y
 		return 0;
 
 	struct map_data *mapdata = map_getmapdata(m);
+	size_t block = npc_touch_block(mapdata, x, y);
 	int f = 1;
 
-	for (int i = 0; i < mapdata->npc_num_area; i++) {
-		switch( npc_touch_areanpc(sd, m, x, y, mapdata->npc[i]) ) {
+	// The list is accessed by index, as events might load or unload NPCs
+	for (size_t i = 0; block < mapdata->npc_touch.size() && i < mapdata->npc_touch[block].size(); i++) {
+		switch( npc_touch_areanpc(sd, m, x, y, mapdata->npc_touch[block][i]) ) {
 		case 0:
 			break;
 		case 1:
@@ -1928,28 +2011,32 @@ int npc_touch_area_allnpc(struct map_session_data* sd, int16 m, int16 x, int16 y
 // Return 1 if Warped
 int npc_touch_areanpc2(struct mob_data *md)
 {
-	int i, x = md->bl.x, y = md->bl.y, id;
+	int x = md->bl.x, y = md->bl.y, id;
+	size_t i;
 	char eventname[EVENT_NAME_LENGTH];
 	struct event_data* ev;
 	int xs, ys;
 	struct map_data *mapdata = map_getmapdata(md->bl.m);
+	size_t block = npc_touch_block(mapdata, x, y);
 
-	for( i = 0; i < mapdata->npc_num_area; i++ )
+	for( i = 0; block < mapdata->npc_touch.size() && i < mapdata->npc_touch[block].size(); i++ )
 	{
-		if( mapdata->npc[i]->sc.option&(OPTION_INVISIBLE|OPTION_CLOAK) )
+		struct npc_data *nd = mapdata->npc_touch[block][i];
+
+		if( nd->sc.option&(OPTION_INVISIBLE|OPTION_CLOAK) )
 			continue;
 
-		switch( mapdata->npc[i]->subtype )
+		switch( nd->subtype )
 		{
 			case NPCTYPE_WARP:
 				if( !( battle_config.mob_warp&1 ) )
 					continue;
-				xs = mapdata->npc[i]->u.warp.xs;
-				ys = mapdata->npc[i]->u.warp.ys;
+				xs = nd->u.warp.xs;
+				ys = nd->u.warp.ys;
 				break;
 			case NPCTYPE_SCRIPT:
-				xs = mapdata->npc[i]->u.scr.xs;
-				ys = mapdata->npc[i]->u.scr.ys;
+				xs = nd->u.scr.xs;
+				ys = nd->u.scr.ys;
 				break;
 			default:
 				continue; // Keep Searching
@@ -1957,26 +2044,26 @@ int npc_touch_areanpc2(struct mob_data *md)
 		if (xs < 0 || ys < 0)
 			continue;
 
-		if( x >= mapdata->npc[i]->bl.x-xs && x <= mapdata->npc[i]->bl.x+xs && y >= mapdata->npc[i]->bl.y-ys && y <= mapdata->npc[i]->bl.y+ys )
+		if( x >= nd->bl.x-xs && x <= nd->bl.x+xs && y >= nd->bl.y-ys && y <= nd->bl.y+ys )
 		{ // In the npc touch area
-			switch( mapdata->npc[i]->subtype )
+			switch( nd->subtype )
 			{
 				case NPCTYPE_WARP: {
-					int16 warp_m = map_mapindex2mapid(mapdata->npc[i]->u.warp.mapindex);
+					int16 warp_m = map_mapindex2mapid(nd->u.warp.mapindex);
 
 					if( warp_m < 0 )
 						break; // Cannot Warp between map servers
-					if( unit_warp(&md->bl, warp_m, mapdata->npc[i]->u.warp.x, mapdata->npc[i]->u.warp.y, CLR_OUTSIGHT) == 0 )
+					if( unit_warp(&md->bl, warp_m, nd->u.warp.x, nd->u.warp.y, CLR_OUTSIGHT) == 0 )
 						return 1; // Warped
 				}
 					break;
 				case NPCTYPE_SCRIPT:
-					if( mapdata->npc[i]->bl.id == md->areanpc_id )
+					if( nd->bl.id == md->areanpc_id )
 						break; // Already touch this NPC
-					safesnprintf(eventname, ARRAYLENGTH(eventname), "%s::%s", mapdata->npc[i]->exname, script_config.ontouchnpc_event_name);
+					safesnprintf(eventname, ARRAYLENGTH(eventname), "%s::%s", nd->exname, script_config.ontouchnpc_event_name);
 					if( (ev = (struct event_data*)strdb_get(ev_db, eventname)) == NULL || ev->nd == NULL )
 						break; // No OnTouchNPC Event
-					md->areanpc_id = mapdata->npc[i]->bl.id;
+					md->areanpc_id = nd->bl.id;
 					id = md->bl.id; // Stores Unique ID
 					run_script(ev->nd->u.scr.script, ev->pos, md->bl.id, ev->nd->bl.id);
 					if( map_id2md(id) == NULL ) return 1; // Not Warped, but killed
@@ -2027,37 +2114,43 @@ int npc_check_areanpc(int flag, int16 m, int16 x, int16 y, int16 range)
 	if (!i) return 0; //No NPC_CELLs.
 
 	//Now check for the actual NPC on said range.
-	for (i = 0; i < mapdata->npc_num_area; i++)
-	{
-		if (mapdata->npc[i]->sc.option&OPTION_INVISIBLE)
-			continue;
+	for (int16 by = y0 - y0 % NPC_TOUCH_BLOCK_SIZE; by <= y1; by += NPC_TOUCH_BLOCK_SIZE) {
+		for (int16 bx = x0 - x0 % NPC_TOUCH_BLOCK_SIZE; bx <= x1; bx += NPC_TOUCH_BLOCK_SIZE) {
+			size_t block = npc_touch_block(mapdata, bx, by);
 
-		switch(mapdata->npc[i]->subtype)
-		{
-		case NPCTYPE_WARP:
-			if (!(flag&1))
-				continue;
-			xs=mapdata->npc[i]->u.warp.xs;
-			ys=mapdata->npc[i]->u.warp.ys;
-			break;
-		case NPCTYPE_SCRIPT:
-			if (!(flag&2))
-				continue;
-			xs=mapdata->npc[i]->u.scr.xs;
-			ys=mapdata->npc[i]->u.scr.ys;
-			break;
-		default:
-			continue;
-		}
+			if (block >= mapdata->npc_touch.size())
+				return 0;
 
-		if( x1 >= mapdata->npc[i]->bl.x-xs && x0 <= mapdata->npc[i]->bl.x+xs
-		&&  y1 >= mapdata->npc[i]->bl.y-ys && y0 <= mapdata->npc[i]->bl.y+ys )
-			break; // found a npc
+			for (struct npc_data *nd : mapdata->npc_touch[block]) {
+				if (nd->sc.option&OPTION_INVISIBLE)
+					continue;
+
+				switch(nd->subtype)
+				{
+				case NPCTYPE_WARP:
+					if (!(flag&1))
+						continue;
+					xs=nd->u.warp.xs;
+					ys=nd->u.warp.ys;
+					break;
+				case NPCTYPE_SCRIPT:
+					if (!(flag&2))
+						continue;
+					xs=nd->u.scr.xs;
+					ys=nd->u.scr.ys;
+					break;
+				default:
+					continue;
+				}
+
+				if( x1 >= nd->bl.x-xs && x0 <= nd->bl.x+xs
+				&&  y1 >= nd->bl.y-ys && y0 <= nd->bl.y+ys )
+					return nd->bl.id; // found a npc
+			}
+		}
 	}
-	if (i == mapdata->npc_num_area)
-		return 0;
 
-	return (mapdata->npc[i]->bl.id);
+	return 0;
 }
 
 /*==========================================
@@ -4829,6 +4922,8 @@ void npc_setcells(struct npc_data* nd)
 	if (m < 0 || xs < 0 || ys < 0) //invalid range or map
 		return;
 
+	npc_touch_index_update(nd, true);
+
 	for (i = y-ys; i <= y+ys; i++) {
 		for (j = x-xs; j <= x+xs; j++) {
 			if (map_getcell(m, j, i, CELL_CHKNOPASS))
@@ -4863,6 +4958,8 @@ void npc_unsetcells(struct npc_data* nd)
 	if (m < 0 || xs < 0 || ys < 0)
 		return;
 
+	npc_touch_index_update(nd, false);
+
 	struct map_data *mapdata = map_getmapdata(m);
 
 	//Locate max range on which we can locate npc cells
@@ -6030,6 +6127,7 @@ void do_init_npc(void){
 
 	add_timer_func_list(npc_event_do_clock,"npc_event_do_clock");
 	add_timer_func_list(npc_timerevent,"npc_timerevent");
+	add_timer_func_list(npc_secure_timeout_timer,"npc_secure_timeout_timer");
 
 	// Init dummy NPC
 	fake_nd = (struct npc_data *)aCalloc(1,sizeof(struct npc_data));
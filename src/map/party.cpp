@@ -4,6 +4,7 @@
 #include "party.hpp"
 
 #include <stdlib.h>
+#include <unordered_set>
 
 #include "../common/cbasetypes.hpp"
 #include "../common/malloc.hpp"
@@ -34,6 +35,7 @@ static unsigned long party_booking_nextid = 1;
 
 TIMER_FUNC(party_send_xy_timer);
 int party_create_byscript;
+static std::unordered_set<int> party_xy_dirty; // party_id of the parties that have to be checked by the next party_send_xy_timer
 
 /*==========================================
  * Fills the given party_member structure according to the sd provided.
@@ -269,6 +271,8 @@ static void party_check_state(struct party_data *p)
 
 int party_recv_info(struct party* sp, uint32 char_id)
 {
+	party_send_xy_mark(sp->party_id);
+
 	struct party_data* p;
 	struct party_member* member;
 	struct map_session_data* sd;
@@ -864,6 +868,8 @@ int party_recv_movemap(int party_id,uint32 account_id,uint32 char_id, unsigned s
 	if( p == NULL )
 		return 0;
 
+	party_send_xy_mark(party_id);
+
 	ARR_FIND( 0, MAX_PARTY, i, p->party.member[i].account_id == account_id && p->party.member[i].char_id == char_id );
 	if( i == MAX_PARTY ) {
 		ShowError("party_recv_movemap: char %d/%d not found in party %s (id:%d)",account_id,char_id,p->party.name,party_id);
@@ -1019,16 +1025,23 @@ int party_skill_check(struct map_session_data *sd, int party_id, uint16 skill_id
 	return 0;
 }
 
-TIMER_FUNC(party_send_xy_timer){
-	struct party_data* p;
-
-	DBIterator *iter = db_iterator(party_db);
+/**
+ * Flags a party to check its members for position and HP changes on the next party_send_xy_timer.
+ * @param party_id: Party ID, ignored if 0
+ */
+void party_send_xy_mark(int party_id)
+{
+	if( party_id )
+		party_xy_dirty.insert(party_id);
+}
 
-	// for each existing party
-	for( p = (struct party_data*)dbi_first(iter); dbi_exists(iter); p = (struct party_data*)dbi_next(iter) ) {
+TIMER_FUNC(party_send_xy_timer){
+	// for each party where something changed
+	for( int party_id : party_xy_dirty ) {
+		struct party_data* p = party_search(party_id);
 		int i;
 
-		if( !p->party.count ) // no online party members so do not iterate
+		if( !p || !p->party.count ) // no online party members so do not iterate
 			continue;
 
 		// for each member of this party
@@ -1050,7 +1063,7 @@ TIMER_FUNC(party_send_xy_timer){
 			}
 		}
 	}
-	dbi_destroy(iter);
+	party_xy_dirty.clear();
 
 	return 0;
 }
@@ -1069,6 +1082,7 @@ int party_send_xy_clear(struct party_data *p)
 		p->data[i].x = 0;
 		p->data[i].y = 0;
 	}
+	party_send_xy_mark(p->party.party_id);
 	return 0;
 }
 
@@ -8,6 +8,13 @@
 #include <stdlib.h>
 #include <string.h>
 
+#include <algorithm>
+#include <functional>
+#include <memory>
+#include <queue>
+#include <unordered_map>
+#include <vector>
+
 #include "../common/cbasetypes.hpp"
 #include "../common/db.hpp"
 #include "../common/malloc.hpp"
@@ -63,6 +70,57 @@ static enum directions walk_choices [3][3] =
 	{DIR_SOUTHWEST,DIR_SOUTH,DIR_SOUTHEAST},
 };
 
+/// @name Hierarchical pathfinding (HPA*)
+/// The map is split into HPA_CLUSTER_SIZE x HPA_CLUSTER_SIZE clusters. Walkable cell pairs on the
+/// border of two clusters become entrance nodes and all entrances of the same cluster are linked
+/// with their walking cost. Long-range queries run A* on this small abstract graph and only
+/// refine the clusters along the route that was found.
+/// The graph of a map is built on first use and dropped whenever the walkability of a cell changes.
+/// @{
+
+/// Minimum width of a border opening that gets an entrance at each of its ends
+#define HPA_ENTRANCE_SPLIT 6
+
+/// Edge of the abstract path graph
+struct s_path_hpa_edge {
+	int32 target; ///< Index of the target node
+	int32 cost; ///< Walking cost in MOVE_COST units
+	int32 steps; ///< Number of cells walked
+};
+
+/// Entrance node of the abstract path graph
+struct s_path_hpa_node {
+	int16 x; ///< X-coordinate
+	int16 y; ///< Y-coordinate
+	int32 cluster; ///< Cluster the cell belongs to
+	int32 component; ///< Nodes with different components are not connected
+	std::vector<s_path_hpa_edge> edges;
+};
+
+/// Abstract path graph of a map
+struct s_path_hpa {
+	int16 cxs, cys; ///< Map dimensions (in clusters)
+	std::vector<s_path_hpa_node> nodes;
+	std::vector<std::vector<int32>> cluster_nodes; ///< Node indexes of each cluster
+
+	// Search state, reused between queries
+	std::vector<int32> g_cost;
+	std::vector<int32> g_steps;
+	std::vector<int32> parent;
+};
+
+/// Walking costs from a cell to every cell of its cluster
+struct s_path_hpa_local {
+	int16 x0, y0; ///< Cluster origin
+	int16 xs, ys; ///< Cluster dimensions
+	int32 cost[HPA_CLUSTER_SIZE * HPA_CLUSTER_SIZE]; ///< -1 if the cell cannot be reached
+	int32 steps[HPA_CLUSTER_SIZE * HPA_CLUSTER_SIZE];
+	int16 parent[HPA_CLUSTER_SIZE * HPA_CLUSTER_SIZE]; ///< Previous cell on the path, -1 for the origin
+};
+
+static std::unordered_map<int16, std::shared_ptr<s_path_hpa>> path_hpa_db;
+static s_path_hpa_local path_hpa_local_data;
+/// @}
 
 void do_init_path(){
 	BHEAP_INIT(g_open_set);	// [fwi]: BHEAP_STRUCT_VAR already initialized the heap, this is rudendant & just for code-conformance/readability
@@ -70,6 +128,7 @@ void do_init_path(){
 
 void do_final_path(){
 	BHEAP_CLEAR(g_open_set);
+	path_hpa_db.clear();
 }//
 
 
@@ -433,6 +492,437 @@ bool path_search(struct walkpath_data *wpd, int16 m, int16 x0, int16 y0, int16 x
 	return false;
 }
 
+/// @name Hierarchical pathfinding related functions
+/// @{
+
+/// Octile distance, an admissible estimate of the walking cost between two cells.
+static int32 path_hpa_heuristic(int16 x0, int16 y0, int16 x1, int16 y1)
+{
+	int32 dx = abs(x1 - x0);
+	int32 dy = abs(y1 - y0);
+
+	return MOVE_COST * max(dx, dy) + (MOVE_DIAGONAL_COST - MOVE_COST) * min(dx, dy);
+}
+
+static bool path_hpa_walkable(struct map_data *mapdata, int16 x, int16 y)
+{
+	return !map_getcellp(mapdata, x, y, CELL_CHKNOREACH);
+}
+
+static int32 path_hpa_cluster(const s_path_hpa &hpa, int16 x, int16 y)
+{
+	return x / HPA_CLUSTER_SIZE + (y / HPA_CLUSTER_SIZE) * hpa.cxs;
+}
+
+/// Calculates the walking cost from (x,y) to every cell of the given cluster without leaving it.
+/// Uses the same movement rules as path_search: diagonal moves may not cut wall corners.
+static void path_hpa_local_search(struct map_data *mapdata, const s_path_hpa &hpa, s_path_hpa_local &local, int32 cluster, int16 x, int16 y)
+{
+	typedef std::pair<int32, int16> t_open_entry;
+	std::priority_queue<t_open_entry, std::vector<t_open_entry>, std::greater<t_open_entry>> open_set;
+
+	local.x0 = (cluster % hpa.cxs) * HPA_CLUSTER_SIZE;
+	local.y0 = (cluster / hpa.cxs) * HPA_CLUSTER_SIZE;
+	local.xs = min(HPA_CLUSTER_SIZE, mapdata->xs - local.x0);
+	local.ys = min(HPA_CLUSTER_SIZE, mapdata->ys - local.y0);
+
+	std::fill(std::begin(local.cost), std::end(local.cost), -1);
+
+	int16 i = (x - local.x0) + (y - local.y0) * HPA_CLUSTER_SIZE;
+
+	local.cost[i] = 0;
+	local.steps[i] = 0;
+	local.parent[i] = -1;
+	open_set.push(t_open_entry(0, i));
+
+	while (!open_set.empty()) {
+		t_open_entry entry = open_set.top();
+
+		open_set.pop();
+
+		i = entry.second;
+
+		if (entry.first > local.cost[i])
+			continue; // Outdated entry
+
+		int16 lx = i % HPA_CLUSTER_SIZE;
+		int16 ly = i / HPA_CLUSTER_SIZE;
+		bool allowed[3][3] = {};
+
+		// Straight moves first, diagonal moves need both adjacent straight moves
+		for (int dy = -1; dy <= 1; dy++) {
+			for (int dx = -1; dx <= 1; dx++) {
+				if ((dx == 0) == (dy == 0))
+					continue;
+				if (lx + dx < 0 || lx + dx >= local.xs || ly + dy < 0 || ly + dy >= local.ys)
+					continue;
+				allowed[dy + 1][dx + 1] = path_hpa_walkable(mapdata, local.x0 + lx + dx, local.y0 + ly + dy);
+			}
+		}
+
+		for (int dy = -1; dy <= 1; dy++) {
+			for (int dx = -1; dx <= 1; dx++) {
+				if (dx == 0 && dy == 0)
+					continue;
+
+				int32 g_cost = entry.first;
+
+				if (dx != 0 && dy != 0) {
+					if (!allowed[1][dx + 1] || !allowed[dy + 1][1] || !path_hpa_walkable(mapdata, local.x0 + lx + dx, local.y0 + ly + dy))
+						continue;
+					g_cost += MOVE_DIAGONAL_COST;
+				} else {
+					if (!allowed[dy + 1][dx + 1])
+						continue;
+					g_cost += MOVE_COST;
+				}
+
+				int16 j = (lx + dx) + (ly + dy) * HPA_CLUSTER_SIZE;
+
+				if (local.cost[j] >= 0 && local.cost[j] <= g_cost)
+					continue;
+
+				local.cost[j] = g_cost;
+				local.steps[j] = local.steps[i] + 1;
+				local.parent[j] = i;
+				open_set.push(t_open_entry(g_cost, j));
+			}
+		}
+	}
+}
+
+/// Returns the index of (x,y) inside the last local search, or -1 if it was not reached.
+static int16 path_hpa_local_index(const s_path_hpa_local &local, int16 x, int16 y)
+{
+	if (x < local.x0 || x >= local.x0 + local.xs || y < local.y0 || y >= local.y0 + local.ys)
+		return -1;
+
+	int16 i = (x - local.x0) + (y - local.y0) * HPA_CLUSTER_SIZE;
+
+	if (local.cost[i] < 0)
+		return -1;
+
+	return i;
+}
+
+/// Builds the abstract path graph of a map.
+static std::shared_ptr<s_path_hpa> path_hpa_build(struct map_data *mapdata)
+{
+	std::shared_ptr<s_path_hpa> hpa = std::make_shared<s_path_hpa>();
+	std::unordered_map<int32, int32> cell2node;
+
+	hpa->cxs = (mapdata->xs + HPA_CLUSTER_SIZE - 1) / HPA_CLUSTER_SIZE;
+	hpa->cys = (mapdata->ys + HPA_CLUSTER_SIZE - 1) / HPA_CLUSTER_SIZE;
+	hpa->cluster_nodes.resize(hpa->cxs * hpa->cys);
+
+	auto add_node = [&](int16 x, int16 y) -> int32 {
+		int32 key = x + y * mapdata->xs;
+		auto it = cell2node.find(key);
+
+		if (it != cell2node.end())
+			return it->second;
+
+		s_path_hpa_node node = {};
+		int32 index = static_cast<int32>(hpa->nodes.size());
+
+		node.x = x;
+		node.y = y;
+		node.cluster = path_hpa_cluster(*hpa, x, y);
+		hpa->nodes.push_back(node);
+		hpa->cluster_nodes[node.cluster].push_back(index);
+		cell2node[key] = index;
+		return index;
+	};
+
+	// Links the cell (x,y) with its neighbour across the border
+	auto add_entrance = [&](int16 x, int16 y, bool vertical) {
+		int32 a = add_node(x, y);
+		int32 b = vertical ? add_node(x + 1, y) : add_node(x, y + 1);
+
+		hpa->nodes[a].edges.push_back({ b, MOVE_COST, 1 });
+		hpa->nodes[b].edges.push_back({ a, MOVE_COST, 1 });
+	};
+
+	// Scans a cluster border for openings; vertical borders separate x and x+1, horizontal ones y and y+1
+	auto scan_border = [&](int16 fixed, int16 from, int16 to, bool vertical) {
+		int16 run_start = -1;
+
+		for (int16 i = from; i <= to; i++) {
+			bool open;
+
+			if (i < to) {
+				if (vertical)
+					open = path_hpa_walkable(mapdata, fixed, i) && path_hpa_walkable(mapdata, fixed + 1, i);
+				else
+					open = path_hpa_walkable(mapdata, i, fixed) && path_hpa_walkable(mapdata, i, fixed + 1);
+			} else
+				open = false;
+
+			if (open) {
+				if (run_start < 0)
+					run_start = i;
+				continue;
+			}
+
+			if (run_start < 0)
+				continue;
+
+			int16 run_end = i - 1;
+
+			if (run_end - run_start + 1 >= HPA_ENTRANCE_SPLIT) {
+				add_entrance(vertical ? fixed : run_start, vertical ? run_start : fixed, vertical);
+				add_entrance(vertical ? fixed : run_end, vertical ? run_end : fixed, vertical);
+			} else {
+				int16 middle = (run_start + run_end) / 2;
+
+				add_entrance(vertical ? fixed : middle, vertical ? middle : fixed, vertical);
+			}
+
+			run_start = -1;
+		}
+	};
+
+	for (int16 cy = 0; cy < hpa->cys; cy++) {
+		for (int16 cx = 0; cx < hpa->cxs; cx++) {
+			int16 x0 = cx * HPA_CLUSTER_SIZE;
+			int16 y0 = cy * HPA_CLUSTER_SIZE;
+			int16 x1 = min(x0 + HPA_CLUSTER_SIZE, mapdata->xs);
+			int16 y1 = min(y0 + HPA_CLUSTER_SIZE, mapdata->ys);
+
+			if (cx + 1 < hpa->cxs)
+				scan_border(x1 - 1, y0, y1, true);
+			if (cy + 1 < hpa->cys)
+				scan_border(y1 - 1, x0, x1, false);
+		}
+	}
+
+	// Link all entrances inside the same cluster
+	for (int32 cluster = 0; cluster < static_cast<int32>(hpa->cluster_nodes.size()); cluster++) {
+		const std::vector<int32> &cluster_nodes = hpa->cluster_nodes[cluster];
+
+		for (int32 a : cluster_nodes) {
+			path_hpa_local_search(mapdata, *hpa, path_hpa_local_data, cluster, hpa->nodes[a].x, hpa->nodes[a].y);
+
+			for (int32 b : cluster_nodes) {
+				if (a == b)
+					continue;
+
+				int16 i = path_hpa_local_index(path_hpa_local_data, hpa->nodes[b].x, hpa->nodes[b].y);
+
+				if (i < 0)
+					continue;
+
+				hpa->nodes[a].edges.push_back({ b, path_hpa_local_data.cost[i], path_hpa_local_data.steps[i] });
+			}
+		}
+	}
+
+	// Label connected components, so unreachable destinations fail without a search
+	for (s_path_hpa_node &node : hpa->nodes)
+		node.component = -1;
+
+	for (int32 root = 0; root < static_cast<int32>(hpa->nodes.size()); root++) {
+		if (hpa->nodes[root].component >= 0)
+			continue;
+
+		std::vector<int32> stack = { root };
+
+		hpa->nodes[root].component = root;
+
+		while (!stack.empty()) {
+			int32 node = stack.back();
+
+			stack.pop_back();
+
+			for (const s_path_hpa_edge &edge : hpa->nodes[node].edges) {
+				if (hpa->nodes[edge.target].component < 0) {
+					hpa->nodes[edge.target].component = root;
+					stack.push_back(edge.target);
+				}
+			}
+		}
+	}
+
+	return hpa;
+}
+
+/// Drops the abstract path graph of a map, it will be rebuilt on the next query.
+/// Has to be called whenever the walkability of a cell changes.
+void path_hpa_invalidate(int16 m)
+{
+	path_hpa_db.erase(m);
+}
+
+/*==========================================
+ * Hierarchical path search (x0,y0)->(x1,y1)
+ * Unlike path_search, the length of the path is not limited.
+ * The path is near optimal and follows the same movement rules (no corner cutting).
+ * path: if not NULL, every cell of the path (excluding the start cell) will be written here
+ * steps: if not NULL, the amount of cells of the path will be written here
+ * Only terrain walkability (CELL_CHKNOREACH) is taken into account.
+ *
+ * Note: uses static search data, therefore this method can't be called in parallel or recursivly.
+ *------------------------------------------*/
+bool path_search_hpa(std::vector<s_path_cell> *path, int *steps, int16 m, int16 x0, int16 y0, int16 x1, int16 y1)
+{
+	struct map_data *mapdata = map_getmapdata(m);
+
+	if (mapdata == nullptr || !mapdata->cell)
+		return false;
+
+	//Do not check starting cell as that would get you stuck.
+	if (x0 < 0 || x0 >= mapdata->xs || y0 < 0 || y0 >= mapdata->ys)
+		return false;
+
+	// Check destination cell
+	if (x1 < 0 || x1 >= mapdata->xs || y1 < 0 || y1 >= mapdata->ys || !path_hpa_walkable(mapdata, x1, y1))
+		return false;
+
+	if (path != nullptr)
+		path->clear();
+
+	if (x0 == x1 && y0 == y1) {
+		if (steps != nullptr)
+			*steps = 0;
+		return true;
+	}
+
+	std::shared_ptr<s_path_hpa> &hpa = path_hpa_db[m];
+
+	if (hpa == nullptr)
+		hpa = path_hpa_build(mapdata);
+
+	s_path_hpa_local &local = path_hpa_local_data;
+	int32 start_cluster = path_hpa_cluster(*hpa, x0, y0);
+	int32 goal_cluster = path_hpa_cluster(*hpa, x1, y1);
+	int32 start = static_cast<int32>(hpa->nodes.size());
+	int32 goal = start + 1;
+	std::vector<s_path_hpa_edge> start_edges, goal_edges;
+	int16 i;
+
+	// Connect the start and goal cells to the entrances of their clusters
+	path_hpa_local_search(mapdata, *hpa, local, start_cluster, x0, y0);
+	for (int32 node : hpa->cluster_nodes[start_cluster]) {
+		if ((i = path_hpa_local_index(local, hpa->nodes[node].x, hpa->nodes[node].y)) >= 0)
+			start_edges.push_back({ node, local.cost[i], local.steps[i] });
+	}
+	if (start_cluster == goal_cluster && (i = path_hpa_local_index(local, x1, y1)) >= 0)
+		start_edges.push_back({ goal, local.cost[i], local.steps[i] });
+
+	path_hpa_local_search(mapdata, *hpa, local, goal_cluster, x1, y1);
+	for (int32 node : hpa->cluster_nodes[goal_cluster]) {
+		if ((i = path_hpa_local_index(local, hpa->nodes[node].x, hpa->nodes[node].y)) >= 0)
+			goal_edges.push_back({ node, local.cost[i], local.steps[i] });
+	}
+
+	bool connected = false;
+
+	for (const s_path_hpa_edge &edge : start_edges) {
+		if (edge.target == goal || std::any_of(goal_edges.begin(), goal_edges.end(), [&](const s_path_hpa_edge &goal_edge) { return hpa->nodes[goal_edge.target].component == hpa->nodes[edge.target].component; })) {
+			connected = true;
+			break;
+		}
+	}
+
+	if (!connected)
+		return false;
+
+	auto node_x = [&](int32 node) -> int16 { return node == start ? x0 : (node == goal ? x1 : hpa->nodes[node].x); };
+	auto node_y = [&](int32 node) -> int16 { return node == start ? y0 : (node == goal ? y1 : hpa->nodes[node].y); };
+
+	// A* on the abstract graph
+	typedef std::pair<int32, int32> t_open_entry;
+	std::priority_queue<t_open_entry, std::vector<t_open_entry>, std::greater<t_open_entry>> open_set;
+
+	hpa->g_cost.assign(hpa->nodes.size() + 2, -1);
+	hpa->g_steps.assign(hpa->nodes.size() + 2, 0);
+	hpa->parent.assign(hpa->nodes.size() + 2, -1);
+
+	hpa->g_cost[start] = 0;
+	open_set.push(t_open_entry(path_hpa_heuristic(x0, y0, x1, y1), start));
+
+	auto relax = [&](int32 from, const s_path_hpa_edge &edge) {
+		int32 g_cost = hpa->g_cost[from] + edge.cost;
+
+		if (hpa->g_cost[edge.target] >= 0 && hpa->g_cost[edge.target] <= g_cost)
+			return;
+
+		hpa->g_cost[edge.target] = g_cost;
+		hpa->g_steps[edge.target] = hpa->g_steps[from] + edge.steps;
+		hpa->parent[edge.target] = from;
+		open_set.push(t_open_entry(g_cost + path_hpa_heuristic(node_x(edge.target), node_y(edge.target), x1, y1), edge.target));
+	};
+
+	while (!open_set.empty()) {
+		t_open_entry entry = open_set.top();
+		int32 current = entry.second;
+
+		open_set.pop();
+
+		if (current == goal)
+			break;
+
+		if (entry.first > hpa->g_cost[current] + path_hpa_heuristic(node_x(current), node_y(current), x1, y1))
+			continue; // Outdated entry
+
+		if (current == start) {
+			for (const s_path_hpa_edge &edge : start_edges)
+				relax(current, edge);
+			continue;
+		}
+
+		for (const s_path_hpa_edge &edge : hpa->nodes[current].edges)
+			relax(current, edge);
+
+		if (hpa->nodes[current].cluster == goal_cluster) {
+			for (const s_path_hpa_edge &edge : goal_edges) {
+				if (edge.target == current) {
+					relax(current, { goal, edge.cost, edge.steps });
+					break;
+				}
+			}
+		}
+	}
+
+	if (hpa->g_cost[goal] < 0)
+		return false;
+
+	if (steps != nullptr)
+		*steps = hpa->g_steps[goal];
+
+	if (path == nullptr)
+		return true;
+
+	// Refine the abstract path into cells
+	std::vector<int32> route;
+
+	for (int32 node = goal; node >= 0; node = hpa->parent[node])
+		route.push_back(node);
+	std::reverse(route.begin(), route.end());
+
+	for (size_t k = 1; k < route.size(); k++) {
+		int16 ax = node_x(route[k - 1]), ay = node_y(route[k - 1]);
+		int16 bx = node_x(route[k]), by = node_y(route[k]);
+		int32 cluster = path_hpa_cluster(*hpa, ax, ay);
+
+		if (cluster != path_hpa_cluster(*hpa, bx, by)) { // Entrance, a single step across the border
+			path->push_back({ bx, by });
+			continue;
+		}
+
+		path_hpa_local_search(mapdata, *hpa, local, cluster, ax, ay);
+
+		size_t offset = path->size();
+
+		for (i = path_hpa_local_index(local, bx, by); i >= 0 && local.parent[i] >= 0; i = local.parent[i])
+			path->push_back({ static_cast<int16>(local.x0 + i % HPA_CLUSTER_SIZE), static_cast<int16>(local.y0 + i / HPA_CLUSTER_SIZE) });
+		std::reverse(path->begin() + offset, path->end());
+	}
+
+	return true;
+}
+/// @}
+
 
 //Distance functions, taken from http://www.flipcode.com/articles/article_fastdistance.shtml
 bool check_distance(int dx, int dy, int distance)
@@ -4,6 +4,8 @@
 #ifndef PATH_HPP
 #define PATH_HPP
 
+#include <vector>
+
 #include "../common/cbasetypes.hpp"
 
 enum cell_chk : uint8;
@@ -13,6 +15,9 @@ enum cell_chk : uint8;
 
 #define MAX_WALKPATH 32
 
+/// Edge length (in cells) of a cluster in the hierarchical path graph
+#define HPA_CLUSTER_SIZE 16
+
 enum directions : int8 {
 	DIR_CENTER = -1,
 	DIR_NORTH = 0,
@@ -31,6 +36,11 @@ struct walkpath_data {
 	enum directions path[MAX_WALKPATH];
 };
 
+/// Single cell of a hierarchical (long-distance) walk path
+struct s_path_cell {
+	int16 x, y;
+};
+
 struct shootpath_data {
 	int rx,ry,len;
 	int x[MAX_WALKPATH];
@@ -62,6 +72,10 @@ bool path_search(struct walkpath_data *wpd,int16 m,int16 x0,int16 y0,int16 x1,in
 // tries to find a shootable path
 bool path_search_long(struct shootpath_data *spd,int16 m,int16 x0,int16 y0,int16 x1,int16 y1,cell_chk cell);
 
+// tries to find a walkable path of any length using the hierarchical path graph
+bool path_search_hpa(std::vector<s_path_cell> *path, int *steps, int16 m, int16 x0, int16 y0, int16 x1, int16 y1);
+void path_hpa_invalidate(int16 m);
+
 // distance related functions
 bool check_distance(int dx, int dy, int distance);
 unsigned int distance(int dx, int dy);
@@ -3,7 +3,9 @@
 
 #include "pc.hpp"
 
+#include <deque>
 #include <map>
+#include <unordered_set>
 
 #include <math.h>
 #include <stdlib.h>
@@ -68,6 +70,7 @@ const char *macro_allowed_answer_chars = "abcdefghijklmnopqrstuvwxyzABCDEFGHIJKL
 
 int pc_split_atoui(char* str, unsigned int* val, char sep, int max);
 static inline bool pc_attendance_rewarded_today( struct map_session_data* sd );
+static void pc_autosave_check_zeny(struct map_session_data *sd);
 
 #define PVP_CALCRANK_INTERVAL 1000	// PVP calculation interval
 
@@ -1800,6 +1803,10 @@ bool pc_authok(struct map_session_data *sd, uint32 login_id2, time_t expiration_
 	memset(&sd->cart, 0, sizeof(struct s_storage));
 	memset(&sd->storage, 0, sizeof(struct s_storage));
 	memset(&sd->premiumStorage, 0, sizeof(struct s_storage));
+	storage_slot_invalidate(&sd->inventory);
+	storage_slot_invalidate(&sd->cart);
+	storage_slot_invalidate(&sd->storage);
+	storage_slot_invalidate(&sd->premiumStorage);
 	memset(&sd->equip_index, -1, sizeof(sd->equip_index));
 	memset(&sd->equip_switch_index, -1, sizeof(sd->equip_switch_index));
 
@@ -5332,17 +5339,16 @@ char pc_checkadditem(struct map_session_data *sd, t_itemid nameid, int amount)
 	if (data->flag.guid)
 		return CHKADDITEM_NEW;
 
-	for(i=0;i<MAX_INVENTORY;i++){
-		// FIXME: This does not consider the checked item's cards, thus could check a wrong slot for stackability.
-		if(sd->inventory.u.items_inventory[i].nameid == nameid){
-			if( amount > MAX_AMOUNT - sd->inventory.u.items_inventory[i].amount || ( data->stack.inventory && amount > data->stack.amount - sd->inventory.u.items_inventory[i].amount ) )
-				return CHKADDITEM_OVERAMOUNT;
-			// If the item is in the inventory already, but the player is not allowed to use that many slots anymore
-			if( i >= sd->status.inventory_slots ){
-				return CHKADDITEM_OVERAMOUNT;
-			}
-			return CHKADDITEM_EXIST;
+	// FIXME: This does not consider the checked item's cards, thus could check a wrong slot for stackability.
+	i = storage_slot_find(&sd->inventory, nameid, MAX_INVENTORY, []( struct item& ) { return true; });
+	if( i >= 0 ){
+		if( amount > MAX_AMOUNT - sd->inventory.u.items_inventory[i].amount || ( data->stack.inventory && amount > data->stack.amount - sd->inventory.u.items_inventory[i].amount ) )
+			return CHKADDITEM_OVERAMOUNT;
+		// If the item is in the inventory already, but the player is not allowed to use that many slots anymore
+		if( i >= sd->status.inventory_slots ){
+			return CHKADDITEM_OVERAMOUNT;
 		}
+		return CHKADDITEM_EXIST;
 	}
 
 	return CHKADDITEM_NEW;
@@ -5356,17 +5362,9 @@ char pc_checkadditem(struct map_session_data *sd, t_itemid nameid, int amount)
  *------------------------------------------*/
 uint8 pc_inventoryblank(struct map_session_data *sd)
 {
-	uint16 i;
-	uint8 b;
-
 	nullpo_ret(sd);
 
-	for(i = 0, b = 0; i < sd->status.inventory_slots; i++){
-		if(sd->inventory.u.items_inventory[i].nameid == 0)
-			b++;
-	}
-
-	return b;
+	return (uint8)storage_slot_freecount(&sd->inventory, sd->status.inventory_slots);
 }
 
 /**
@@ -5393,6 +5391,7 @@ char pc_payzeny(struct map_session_data *sd, int zeny, enum e_log_pick_type type
 
 	sd->status.zeny -= zeny;
 	clif_updatestatus(sd,SP_ZENY);
+	pc_autosave_check_zeny(sd);
 
 	if(!tsd) tsd = sd;
 	log_zeny(sd, type, tsd, -zeny);
@@ -5428,6 +5427,7 @@ char pc_getzeny(struct map_session_data *sd, int zeny, enum e_log_pick_type type
 
 	sd->status.zeny += zeny;
 	clif_updatestatus(sd,SP_ZENY);
+	pc_autosave_check_zeny(sd);
 
 	if(!tsd) tsd = sd;
 	log_zeny(sd, type, tsd, zeny);
@@ -5553,11 +5553,12 @@ int pc_getcash(struct map_session_data *sd, int cash, int points, e_log_pick_typ
  * @return Stored index in inventory, or -1 if not found.
  **/
 short pc_search_inventory(struct map_session_data *sd, t_itemid nameid) {
-	short i;
 	nullpo_retr(-1, sd);
 
-	ARR_FIND( 0, MAX_INVENTORY, i, sd->inventory.u.items_inventory[i].nameid == nameid && (sd->inventory.u.items_inventory[i].amount > 0 || nameid == 0) );
-	return ( i < MAX_INVENTORY ) ? i : -1;
+	if( nameid == 0 )
+		return storage_slot_free(&sd->inventory, MAX_INVENTORY);
+
+	return storage_slot_find(&sd->inventory, nameid, MAX_INVENTORY, []( struct item& slot ) { return slot.amount > 0; });
 }
 
 /** Attempt to add a new item to player inventory
@@ -5604,23 +5605,23 @@ enum e_additem_result pc_additem(struct map_session_data *sd,struct item *item,i
 
 	// Stackable | Non Rental
 	if( itemdb_isstackable2(id) && item->expire_time == 0 ) {
-		for( i = 0; i < MAX_INVENTORY; i++ ) {
-			if( sd->inventory.u.items_inventory[i].nameid == item->nameid &&
-				sd->inventory.u.items_inventory[i].bound == item->bound &&
-				sd->inventory.u.items_inventory[i].expire_time == 0 &&
-				sd->inventory.u.items_inventory[i].unique_id == item->unique_id &&
-				memcmp(&sd->inventory.u.items_inventory[i].card, &item->card, sizeof(item->card)) == 0 ) {
-				if( amount > MAX_AMOUNT - sd->inventory.u.items_inventory[i].amount || ( id->stack.inventory && amount > id->stack.amount - sd->inventory.u.items_inventory[i].amount ) )
-					return ADDITEM_OVERAMOUNT;
-				// If the item is in the inventory already, but the player is not allowed to use that many slots anymore
-				if( i >= sd->status.inventory_slots ){
-					return ADDITEM_OVERAMOUNT;
-				}
-				sd->inventory.u.items_inventory[i].amount += amount;
-				clif_additem(sd,i,amount,0);
-				break;
+		i = storage_slot_find(&sd->inventory, item->nameid, MAX_INVENTORY, [item]( struct item& slot ) {
+			return slot.bound == item->bound &&
+				slot.expire_time == 0 &&
+				slot.unique_id == item->unique_id &&
+				memcmp(&slot.card, &item->card, sizeof(item->card)) == 0;
+		});
+		if( i >= 0 ) {
+			if( amount > MAX_AMOUNT - sd->inventory.u.items_inventory[i].amount || ( id->stack.inventory && amount > id->stack.amount - sd->inventory.u.items_inventory[i].amount ) )
+				return ADDITEM_OVERAMOUNT;
+			// If the item is in the inventory already, but the player is not allowed to use that many slots anymore
+			if( i >= sd->status.inventory_slots ){
+				return ADDITEM_OVERAMOUNT;
 			}
-		}
+			sd->inventory.u.items_inventory[i].amount += amount;
+			clif_additem(sd,i,amount,0);
+		}else
+			i = MAX_INVENTORY;
 	}else{
 		i = MAX_INVENTORY;
  	}
@@ -5634,6 +5635,7 @@ enum e_additem_result pc_additem(struct map_session_data *sd,struct item *item,i
 		}
 
 		memcpy(&sd->inventory.u.items_inventory[i], item, sizeof(sd->inventory.u.items_inventory[0]));
+		storage_slot_update(&sd->inventory, i);
 		// clear equip and favorite fields first, just in case
 		if( item->equip )
 			sd->inventory.u.items_inventory[i].equip = 0;
@@ -5672,6 +5674,10 @@ enum e_additem_result pc_additem(struct map_session_data *sd,struct item *item,i
 		}
 	}
 
+	// Items worth announcing are worth saving early
+	if (id->flag.broadcast)
+		pc_autosave_prioritize(sd);
+
 	achievement_update_objective(sd, AG_GET_ITEM, 1, id->value_sell);
 	pc_show_questinfo(sd);
 
@@ -5703,6 +5709,7 @@ char pc_delitem(struct map_session_data *sd,int n,int amount,int type, short rea
 		if(sd->inventory.u.items_inventory[n].equip)
 			pc_unequipitem(sd,n,2|(!(type&4) ? 1 : 0));
 		memset(&sd->inventory.u.items_inventory[n],0,sizeof(sd->inventory.u.items_inventory[0]));
+		storage_slot_update(&sd->inventory, n);
 		sd->inventory_data[n] = NULL;
 	}
 	if(!(type&1))
@@ -6145,20 +6152,17 @@ enum e_additem_result pc_cart_additem(struct map_session_data *sd,struct item *i
 	if( (w = data->weight*amount) + sd->cart_weight > sd->cart_weight_max )
 		return ADDITEM_OVERWEIGHT;
 
-	i = MAX_CART;
+	i = -1;
 	if( itemdb_isstackable2(data) && !item->expire_time )
 	{
-		for (i = 0; i < MAX_CART; i++) {
-			if (sd->cart.u.items_cart[i].nameid == item->nameid
-				&& sd->cart.u.items_cart[i].bound == item->bound
-				&& sd->cart.u.items_cart[i].unique_id == item->unique_id
-				&& memcmp(sd->cart.u.items_cart[i].card, item->card, sizeof(item->card)) == 0
-				)
-				break;
-		}
+		i = storage_slot_find(&sd->cart, item->nameid, MAX_CART, [item]( struct item& slot ) {
+			return slot.bound == item->bound
+				&& slot.unique_id == item->unique_id
+				&& memcmp(slot.card, item->card, sizeof(item->card)) == 0;
+		});
 	}
 
-	if( i < MAX_CART )
+	if( i >= 0 )
 	{// item already in cart, stack it
 		if( amount > MAX_AMOUNT - sd->cart.u.items_cart[i].amount || ( data->stack.cart && amount > data->stack.amount - sd->cart.u.items_cart[i].amount ) )
 			return ADDITEM_OVERAMOUNT; // no slot
@@ -6168,11 +6172,11 @@ enum e_additem_result pc_cart_additem(struct map_session_data *sd,struct item *i
 	}
 	else
 	{// item not stackable or not present, add it
-		ARR_FIND( 0, MAX_CART, i, sd->cart.u.items_cart[i].nameid == 0 );
-		if( i == MAX_CART )
+		if( ( i = storage_slot_free(&sd->cart, MAX_CART) ) < 0 )
 			return ADDITEM_OVERAMOUNT; // no slot
 
 		memcpy(&sd->cart.u.items_cart[i],item,sizeof(sd->cart.u.items_cart[0]));
+		storage_slot_update(&sd->cart, i);
 		sd->cart.u.items_cart[i].id = 0;
 		sd->cart.u.items_cart[i].amount = amount;
 		sd->cart_num++;
@@ -6205,6 +6209,7 @@ void pc_cart_delitem(struct map_session_data *sd,int n,int amount,int type,e_log
 	sd->cart_weight -= itemdb_weight(sd->cart.u.items_cart[n].nameid) * amount;
 	if(sd->cart.u.items_cart[n].amount <= 0) {
 		memset(&sd->cart.u.items_cart[n],0,sizeof(sd->cart.u.items_cart[0]));
+		storage_slot_update(&sd->cart, n);
 		sd->cart_num--;
 	}
 	if(!type) {
@@ -9190,6 +9195,7 @@ static TIMER_FUNC(pc_respawn_timer){
  *------------------------------------------*/
 void pc_damage(struct map_session_data *sd,struct block_list *src,unsigned int hp, unsigned int sp, unsigned int ap)
 {
+	if (hp) party_send_xy_mark(sd->status.party_id); // Update the HP of party members
 	if (ap) clif_updatestatus(sd,SP_AP);
 	if (sp) clif_updatestatus(sd,SP_SP);
 	if (hp) clif_updatestatus(sd,SP_HP);
@@ -9643,7 +9649,10 @@ int pc_dead(struct map_session_data *sd,struct block_list *src)
 }
 
 void pc_revive(struct map_session_data *sd,unsigned int hp, unsigned int sp, unsigned int ap) {
-	if(hp) clif_updatestatus(sd,SP_HP);
+	if(hp) {
+		clif_updatestatus(sd,SP_HP);
+		party_send_xy_mark(sd->status.party_id); // Update the HP of party members
+	}
 	if(sp) clif_updatestatus(sd,SP_SP);
 	if(ap) clif_updatestatus(sd,SP_AP);
 
@@ -10142,6 +10151,12 @@ bool pc_setparam(struct map_session_data *sd,int64 type,int64 val_tmp)
 	}
 	clif_updatestatus(sd,static_cast<int>(type));
 
+	// HP/SP written directly, the player might be parked out of natural regen
+	if (type == SP_HP || type == SP_MAXHP || type == SP_SP || type == SP_MAXSP)
+		status_natural_heal_wake(&sd->bl);
+	if (type == SP_HP || type == SP_MAXHP)
+		party_send_xy_mark(sd->status.party_id); // Update the HP of party members
+
 	return true;
 }
 
@@ -10152,6 +10167,9 @@ void pc_heal(struct map_session_data *sd,unsigned int hp,unsigned int sp, unsign
 {// Is there going to be a effect for gaining AP soon??? [Rytech]
 	nullpo_retv(sd);
 
+	if (hp)
+		party_send_xy_mark(sd->status.party_id); // Update the HP of party members
+
 	if (type&2) {
 		if (hp || type&4) {
 			clif_heal(sd->fd,SP_HP,hp);
@@ -12479,50 +12497,147 @@ void pc_setsavepoint(struct map_session_data *sd, short mapindex,int x,int y)
 }
 
 /*==========================================
- * Save 1 player data at autosave interval
+ * Autosave scheduler
+ * Players are saved round-robin so that everyone is saved once per autosave_time.
+ * Saves are issued in bursts every PC_AUTOSAVE_TICK ms, limited by the
+ * autosave_budget (saves per second). Players with valuable unsaved changes
+ * are moved ahead of the regular queue.
  *------------------------------------------*/
-static TIMER_FUNC(pc_autosave){
-	int interval;
-	struct s_mapiterator* iter;
-	struct map_session_data* sd;
-	static int last_save_id = 0, save_flag = 0;
+static std::deque<uint32> pc_autosave_queue; ///< Round-robin order of the account ids to save
+static std::deque<uint32> pc_autosave_priority_queue; ///< Account ids with valuable unsaved changes
+static std::unordered_set<uint32> pc_autosave_queued; ///< Account ids in pc_autosave_queue
+static std::unordered_set<uint32> pc_autosave_prioritized; ///< Account ids in pc_autosave_priority_queue
+static double pc_autosave_credit = 0; ///< Saves that may be issued, refilled every tick
 
-	if(save_flag == 2) //Someone was saved on last call, normal cycle
-		save_flag = 0;
-	else
-		save_flag = 1; //Noone was saved, so save first found char.
+static struct {
+	uint64 saves; ///< Total amount of autosaves
+	uint64 priority_saves; ///< Autosaves issued from the priority queue
+	uint32 last_burst; ///< Amount of saves of the last tick
+	size_t max_depth; ///< Highest priority queue depth seen
+} pc_autosave_stats;
 
-	iter = mapit_getallusers();
-	for( sd = (TBL_PC*)mapit_first(iter); mapit_exists(iter); sd = (TBL_PC*)mapit_next(iter) )
-	{
-		if (!sd->state.pc_loaded) // Player data hasn't fully loaded
-			continue;
-		if(sd->bl.id == last_save_id && save_flag != 1) {
-			save_flag = 1;
+/**
+ * Adds a player to the autosave rotation, once his data is fully loaded
+ * @param sd: Player data
+ */
+void pc_autosave_add(struct map_session_data *sd) {
+	nullpo_retv(sd);
+
+	if (pc_autosave_queued.insert(sd->status.account_id).second)
+		pc_autosave_queue.push_back(sd->status.account_id);
+}
+
+/**
+ * Saves a player before the rest of the rotation
+ * @param sd: Player data
+ */
+void pc_autosave_prioritize(struct map_session_data *sd) {
+	nullpo_retv(sd);
+
+	if (!sd->state.pc_loaded)
+		return;
+
+	if (pc_autosave_prioritized.insert(sd->status.account_id).second) {
+		pc_autosave_priority_queue.push_back(sd->status.account_id);
+		pc_autosave_stats.max_depth = std::max(pc_autosave_stats.max_depth, pc_autosave_priority_queue.size());
+	}
+}
+
+/**
+ * Prioritizes the save of a player whose zeny moved far enough from the last saved value
+ * @param sd: Player data
+ */
+static void pc_autosave_check_zeny(struct map_session_data *sd) {
+	if (autosave_priority_zeny <= 0 || sd->status_saved == nullptr)
+		return;
+
+	if (std::abs((int64)sd->status.zeny - sd->status_saved->zeny) >= autosave_priority_zeny)
+		pc_autosave_prioritize(sd);
+}
+
+/**
+ * Issues a save from one of the queues
+ * @param queue: Queue to take the player from
+ * @param queued: Membership set of the queue
+ * @param requeue: Whether the player goes back to the end of the queue
+ * @return True if a player was saved, false if there was nobody to save
+ */
+static bool pc_autosave_pop(std::deque<uint32> &queue, std::unordered_set<uint32> &queued, bool requeue) {
+	// Each entry is looked at once at most, requeued players might not be loaded yet
+	for (size_t checks = queue.size(); checks > 0; checks--) {
+		uint32 account_id = queue.front();
+		struct map_session_data *sd = map_id2sd(account_id);
+
+		queue.pop_front();
+
+		if (sd == nullptr) { // Player left, drop him from the rotation
+			queued.erase(account_id);
 			continue;
 		}
 
-		if(save_flag != 1) //Not our turn to save yet.
+		if (requeue)
+			queue.push_back(account_id);
+		else
+			queued.erase(account_id);
+
+		if (!sd->state.pc_loaded) // Player data hasn't fully loaded
 			continue;
 
-		//Save char.
-		last_save_id = sd->bl.id;
-		save_flag = 2;
 		if (pc_isvip(sd)) // Check if we're still VIP
 			chrif_req_login_operation(1, sd->status.name, CHRIF_OP_LOGIN_VIP, 0, 1, 0);
 		chrif_save(sd, CSAVE_INVENTORY|CSAVE_CART);
-		break;
+		return true;
 	}
-	mapit_free(iter);
 
-	interval = autosave_interval/(map_usercount()+1);
-	if(interval < minsave_interval)
-		interval = minsave_interval;
-	add_timer(gettick()+interval,pc_autosave,0,0);
+	return false;
+}
+
+static TIMER_FUNC(pc_autosave){
+	double users = (double)pc_autosave_queue.size();
+	// Rate needed to save everyone once per autosave_time
+	double rate = users * PC_AUTOSAVE_TICK / autosave_interval;
+	// Without a budget of its own, keep to the old minsave_time spacing
+	int budget = autosave_budget > 0 ? autosave_budget : max(1, 1000 / minsave_interval);
+	double limit = (double)budget * PC_AUTOSAVE_TICK / 1000;
+	uint32 burst = 0;
+
+	// Spare budget is spent on players with valuable changes
+	if (!pc_autosave_priority_queue.empty())
+		rate = limit;
+	rate = std::min(rate, limit);
+
+	// Do not hoard credit while idle, but allow one tick of catching up
+	pc_autosave_credit = std::min(pc_autosave_credit + rate, rate * 2 + 1);
+
+	while (pc_autosave_credit >= 1) {
+		if (pc_autosave_pop(pc_autosave_priority_queue, pc_autosave_prioritized, false))
+			pc_autosave_stats.priority_saves++;
+		else if (!pc_autosave_pop(pc_autosave_queue, pc_autosave_queued, true))
+			break;
+
+		pc_autosave_credit -= 1;
+		burst++;
+	}
+
+	if (pc_autosave_queue.empty() && pc_autosave_priority_queue.empty())
+		pc_autosave_credit = 0;
+
+	pc_autosave_stats.saves += burst;
+	pc_autosave_stats.last_burst = burst;
 
 	return 0;
 }
 
+/**
+ * Displays the state of the autosave scheduler on the console
+ */
+void pc_autosave_report(void) {
+	ShowInfo("Autosave scheduler:\n");
+	ShowInfo("\t Players in rotation: %" PRIuPTR ", waiting with priority: %" PRIuPTR " (max %" PRIuPTR ")\n", pc_autosave_queue.size(), pc_autosave_priority_queue.size(), pc_autosave_stats.max_depth);
+	ShowInfo("\t Saves: %" PRIu64 " (%" PRIu64 " prioritized), last burst: %u\n", pc_autosave_stats.saves, pc_autosave_stats.priority_saves, pc_autosave_stats.last_burst);
+	ShowInfo("\t Budget: %d saves/s, cycle: %d s\n", autosave_budget > 0 ? autosave_budget : max(1, 1000 / minsave_interval), autosave_interval / 1000);
+}
+
 static int pc_daynight_timer_sub(struct map_session_data *sd,va_list ap)
 {
 	if (sd->state.night != night_flag && map_getmapflag(sd->bl.m, MF_NIGHTENABLED))
@@ -14199,6 +14314,7 @@ void pc_scdata_received(struct map_session_data *sd) {
 	}
 
 	sd->state.pc_loaded = true;
+	pc_autosave_add(sd);
 
 	if (sd->state.connect_new == 0 && sd->fd) { // Character already loaded map! Gotta trigger LoadEndAck manually.
 		sd->state.connect_new = 1;
@@ -15452,8 +15568,11 @@ void do_init_pc(void) {
 	add_timer_func_list(pc_autotrade_timer, "pc_autotrade_timer");
 	add_timer_func_list(pc_on_expire_active, "pc_on_expire_active");
 	add_timer_func_list(pc_macro_detector_timeout, "pc_macro_detector_timeout");
+	add_timer_func_list(pc_respawn_timer, "pc_respawn_timer");
+	add_timer_func_list(pc_close_npc_timer, "pc_close_npc_timer");
+	add_timer_func_list(pc_bonus_script_timer, "pc_bonus_script_timer");
 
-	add_timer(gettick() + autosave_interval, pc_autosave, 0, 0);
+	add_timer_interval(gettick() + PC_AUTOSAVE_TICK, pc_autosave, 0, 0, PC_AUTOSAVE_TICK);
 
 	// 0=day, 1=night [Yor]
 	night_flag = battle_config.night_at_start ? 1 : 0;
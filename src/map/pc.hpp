@@ -21,6 +21,7 @@
 #include "map.hpp" // RC_ALL
 #include "mob.hpp" //e_size
 #include "pc_groups.hpp" // s_player_group
+#include "quest.hpp" // s_quest_kill_index
 #include "script.hpp" // struct script_reg, struct script_regstr
 #include "searchstore.hpp"  // struct s_search_store_info
 #include "status.hpp" // unit_data
@@ -45,6 +46,7 @@ enum sc_type : int16;
 #define MAX_SERVANTBALL 5 /// Max servant weapons
 #define MAX_SERVANT_SIGN 5 /// Max servant signs
 #define MAX_ABYSSBALL 5 /// Max abyss spheres
+#define PC_AUTOSAVE_TICK 100 /// Interval of the autosave scheduler bursts [ms]
 
 #define LANGTYPE_VAR "#langtype"
 #define CASHPOINT_VAR "#CASHPOINTS"
@@ -790,6 +792,7 @@ struct map_session_data {
 	int num_quests;          ///< Number of entries in quest_log
 	int avail_quests;        ///< Number of Q_ACTIVE and Q_INACTIVE entries in quest log (index of the first Q_COMPLETE entry)
 	struct quest *quest_log; ///< Quest log entries (note: Q_COMPLETE quests follow the first <avail_quests>th enties
+	s_quest_kill_index quest_kill_index; ///< Kill objectives of the Q_ACTIVE and Q_INACTIVE entries in quest log
 	bool save_quest;         ///< Whether the quest_log entries were modified and are waitin to be saved
 
 	// Achievement log system
@@ -868,6 +871,9 @@ struct map_session_data {
 	bool vars_ok;
 	bool vars_dirty;
 
+	struct mmo_charstatus *status_saved; ///< Status last sent to the char-server, base of delta saves
+	uint32 status_version; ///< Version of status_saved known by the char-server, 0 forces a complete save
+
 	uint16 dmglog[DAMAGELOG_SIZE_PC]; ///target ids
 
 	int c_marker[MAX_SKILL_CRIMSON_MARKER]; /// Store target that marked by Crimson Marker [Cydh]
@@ -1680,6 +1686,10 @@ bool pc_is_same_equip_index(enum equip_index eqi, short *equip_index, short inde
 
 TIMER_FUNC(pc_autotrade_timer);
 
+void pc_autosave_add(struct map_session_data *sd);
+void pc_autosave_prioritize(struct map_session_data *sd);
+void pc_autosave_report(void);
+
 void pc_validate_skill(struct map_session_data *sd);
 
 void pc_show_questinfo(struct map_session_data *sd);
@@ -28,6 +28,7 @@
 #include "mob.hpp"
 #include "npc.hpp"
 #include "pc.hpp"
+#include "storage.hpp"
 
 using namespace rathena;
 
@@ -2292,6 +2293,7 @@ void pet_evolution(struct map_session_data *sd, int16 pet_id) {
 
 	// Change the old egg to the new one
 	sd->inventory.u.items_inventory[idx].nameid = new_data->EggID;
+	storage_slot_update(&sd->inventory, idx);
 	sd->inventory_data[idx] = itemdb_search(new_data->EggID);
 
 	// Virtually add it to the inventory
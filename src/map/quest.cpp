@@ -3,6 +3,7 @@
 
 #include "quest.hpp"
 
+#include <algorithm>
 #include <stdlib.h>
 
 #include "../common/cbasetypes.hpp"
@@ -581,6 +582,7 @@ int quest_add(struct map_session_data *sd, int quest_id)
 	sd->quest_log[n].time = (uint32)quest_time(qi);
 	sd->quest_log[n].state = Q_ACTIVE;
 	sd->save_quest = true;
+	quest_build_kill_index(sd);
 
 	clif_quest_add(sd, &sd->quest_log[n]);
 	clif_quest_update_objective(sd, &sd->quest_log[n]);
@@ -630,6 +632,7 @@ int quest_change(struct map_session_data *sd, int qid1, int qid2)
 	sd->quest_log[i].time = (uint32)quest_time(qi);
 	sd->quest_log[i].state = Q_ACTIVE;
 	sd->save_quest = true;
+	quest_build_kill_index(sd);
 
 	clif_quest_delete(sd, qid1);
 	clif_quest_add(sd, &sd->quest_log[i]);
@@ -671,6 +674,7 @@ int quest_delete(struct map_session_data *sd, int quest_id)
 		RECREATE(sd->quest_log, struct quest, sd->num_quests);
 
 	sd->save_quest = true;
+	quest_build_kill_index(sd);
 
 	clif_quest_delete(sd, quest_id);
 
@@ -680,6 +684,97 @@ int quest_delete(struct map_session_data *sd, int quest_id)
 	return 0;
 }
 
+/**
+ * Rebuilds the kill objective index of a character from its quest log.
+ * Has to be called whenever entries are added to, removed from or moved in the quest log.
+ * @param sd : Character's data
+ */
+void quest_build_kill_index(struct map_session_data *sd)
+{
+	nullpo_retv(sd);
+
+	s_quest_kill_index &index = sd->quest_kill_index;
+
+	index.clear();
+
+	for (int i = 0; i < sd->avail_quests; i++) {
+		if (sd->quest_log[i].state == Q_COMPLETE)
+			continue;
+
+		std::shared_ptr<s_quest_db> qi = quest_search(sd->quest_log[i].quest_id);
+
+		if (!qi)
+			continue;
+
+		for (uint8 j = 0; j < qi->objectives.size(); j++) {
+			s_quest_kill_objective entry = { qi->objectives[j]->mob_id, i, j, qi->objectives[j] };
+
+			if (entry.mob_id != 0)
+				index.objectives.push_back(entry);
+			else
+				index.wildcards.push_back(entry);
+		}
+
+		for (const auto &it : qi->dropitem)
+			index.drops.push_back({ it->mob_id, it });
+	}
+
+	std::stable_sort(index.objectives.begin(), index.objectives.end(), []( const s_quest_kill_objective &a, const s_quest_kill_objective &b ){
+		return a.mob_id < b.mob_id;
+	});
+	std::stable_sort(index.drops.begin(), index.drops.end(), []( const s_quest_kill_drop &a, const s_quest_kill_drop &b ){
+		return a.mob_id < b.mob_id;
+	});
+}
+
+/**
+ * Increases the kill counter of a quest objective.
+ * @param sd : Character's data
+ * @param entry : Indexed objective
+ */
+static void quest_update_objective_count(struct map_session_data *sd, const s_quest_kill_objective &entry)
+{
+	struct quest &quest = sd->quest_log[entry.index];
+
+	if (quest.count[entry.objective] >= entry.data->count)
+		return;
+
+	quest.count[entry.objective]++;
+	sd->save_quest = true;
+	clif_quest_update_objective(sd, &quest);
+}
+
+/**
+ * Hands out a quest-granted extra drop bonus.
+ * @param sd : Character's data
+ * @param it : Drop bonus
+ */
+static void quest_drop_item(struct map_session_data *sd, std::shared_ptr<s_quest_dropitem> it)
+{
+	if (it->rate < 10000 && rnd()%10000 >= it->rate)
+		return; // TODO: Should this be affected by server rates?
+	if (!item_db.exists(it->nameid))
+		return;
+
+	struct item entry = {};
+
+	entry.nameid = it->nameid;
+	entry.identify = itemdb_isidentified(it->nameid);
+	entry.amount = it->count;
+//#ifdef BOUND_ITEMS
+//	entry.bound = it->bound;
+//#endif
+//	if (it.isGUID)
+//		item.unique_id = pc_generate_unique_id(sd);
+
+	e_additem_result result;
+
+	if ((result = pc_additem(sd, &entry, 1, LOG_TYPE_QUEST)) != ADDITEM_SUCCESS) // Failed to obtain the item
+		clif_additem(sd, 0, 0, result);
+//	else if (it.isAnnounced || item_db.find(it.nameid)->flag.broadcast)
+//		intif_broadcast_obtain_special_item(sd, it.nameid, it.mob_id, ITEMOBTAIN_TYPE_MONSTER_ITEM);
+}
+
 /**
  * Map iterator subroutine to update quest objectives for a party after killing a monster.
  * @see map_foreachinrange
@@ -723,82 +818,52 @@ void quest_update_objective(struct map_session_data *sd, struct mob_data* md)
 {
 	nullpo_retv(sd);
 
-	for (int i = 0; i < sd->avail_quests; i++) {
-		if (sd->quest_log[i].state == Q_COMPLETE) // Skip complete quests
-			continue;
+	s_quest_kill_index &index = sd->quest_kill_index;
+	uint16 mob_id = md->mob_id;
+	auto by_mob = []( const s_quest_kill_objective &entry, uint16 candidate ){ return entry.mob_id < candidate; };
+	auto objective = std::lower_bound(index.objectives.begin(), index.objectives.end(), mob_id, by_mob);
 
-		std::shared_ptr<s_quest_db> qi = quest_search(sd->quest_log[i].quest_id);
-		if (!qi)
-			continue;
+	// Process quest objectives for this monster
+	for (; objective != index.objectives.end() && objective->mob_id == mob_id; objective++)
+		quest_update_objective_count(sd, *objective);
 
-		// Process quest objectives
-		uint8 total_check = 7; // Must pass all checks
-
-		for (int j = 0; j < qi->objectives.size(); j++) {
-			uint8 objective_check = 0;
-
-			if (qi->objectives[j]->mob_id == md->mob_id)
-				objective_check = total_check;
-			else if (qi->objectives[j]->mob_id == 0) {
-				if (qi->objectives[j]->min_level == 0 || qi->objectives[j]->min_level <= md->level)
-					objective_check++;
-				if (qi->objectives[j]->max_level == 0 || qi->objectives[j]->max_level >= md->level)
-					objective_check++;
-				if (qi->objectives[j]->race == RC_ALL || qi->objectives[j]->race == md->status.race)
-					objective_check++;
-				if (qi->objectives[j]->size == SZ_ALL || qi->objectives[j]->size == md->status.size)
-					objective_check++;
-				if (qi->objectives[j]->element == ELE_ALL || qi->objectives[j]->element == md->status.def_ele)
-					objective_check++;
-				if (qi->objectives[j]->mapid < 0)
-					objective_check++;
-				else if (qi->objectives[j]->mapid == sd->bl.m)
-					objective_check++;
-				else {
-					struct map_data *mapdata = map_getmapdata(sd->bl.m);
-
-					if (mapdata->instance_id && mapdata->instance_src_map == qi->objectives[j]->mapid)
-						objective_check++;
-				}
-				if (qi->objectives[j]->mobs_allowed.empty() || util::vector_exists( qi->objectives[j]->mobs_allowed, md->mob_id ))
-					objective_check++;
-			}
+	// Process quest objectives matched by the monster's properties
+	for (const auto &it : index.wildcards) {
+		std::shared_ptr<s_quest_objective> data = it.data;
 
-			if (objective_check == total_check && sd->quest_log[i].count[j] < qi->objectives[j]->count)  {
-				sd->quest_log[i].count[j]++;
-				sd->save_quest = true;
-				clif_quest_update_objective(sd, &sd->quest_log[i]);
-			}
-		}
+		if (data->min_level != 0 && data->min_level > md->level)
+			continue;
+		if (data->max_level != 0 && data->max_level < md->level)
+			continue;
+		if (data->race != RC_ALL && data->race != md->status.race)
+			continue;
+		if (data->size != SZ_ALL && data->size != md->status.size)
+			continue;
+		if (data->element != ELE_ALL && data->element != md->status.def_ele)
+			continue;
+		if (data->mapid >= 0 && data->mapid != sd->bl.m) {
+			struct map_data *mapdata = map_getmapdata(sd->bl.m);
 
-		// Process quest-granted extra drop bonuses
-		for (const auto &it : qi->dropitem) {
-			if (it->mob_id != 0 && it->mob_id != md->mob_id)
-				continue;
-			if (it->rate < 10000 && rnd()%10000 >= it->rate)
-				continue; // TODO: Should this be affected by server rates?
-			if (!item_db.exists(it->nameid))
+			if (!mapdata->instance_id || mapdata->instance_src_map != data->mapid)
 				continue;
+		}
+		if (!data->mobs_allowed.empty() && !util::vector_exists( data->mobs_allowed, md->mob_id ))
+			continue;
 
-			struct item entry = {};
+		quest_update_objective_count(sd, it);
+	}
 
-			entry.nameid = it->nameid;
-			entry.identify = itemdb_isidentified(it->nameid);
-			entry.amount = it->count;
-//#ifdef BOUND_ITEMS
-//			entry.bound = it->bound;
-//#endif
-//			if (it.isGUID)
-//				item.unique_id = pc_generate_unique_id(sd);
-			
-			e_additem_result result;
-
-			if ((result = pc_additem(sd, &entry, 1, LOG_TYPE_QUEST)) != ADDITEM_SUCCESS) // Failed to obtain the item
-				clif_additem(sd, 0, 0, result);
-//			else if (it.isAnnounced || item_db.find(it.nameid)->flag.broadcast)
-//				intif_broadcast_obtain_special_item(sd, it.nameid, it.mob_id, ITEMOBTAIN_TYPE_MONSTER_ITEM);
-		}
+	// Process quest-granted extra drop bonuses for any monster and for this monster
+	auto drop_by_mob = []( const s_quest_kill_drop &entry, uint16 candidate ){ return entry.mob_id < candidate; };
+
+	for (auto drop = index.drops.begin(); drop != index.drops.end() && drop->mob_id == 0; drop++)
+		quest_drop_item(sd, drop->data);
+
+	if (mob_id != 0) {
+		for (auto drop = std::lower_bound(index.drops.begin(), index.drops.end(), mob_id, drop_by_mob); drop != index.drops.end() && drop->mob_id == mob_id; drop++)
+			quest_drop_item(sd, drop->data);
 	}
+
 	pc_show_questinfo(sd);
 }
 
@@ -838,6 +903,8 @@ int quest_update_status(struct map_session_data *sd, int quest_id, e_quest_state
 		memcpy(&sd->quest_log[sd->avail_quests], &tmp_quest, sizeof(struct quest));
 	}
 
+	quest_build_kill_index(sd);
+
 	clif_quest_delete(sd, quest_id);
 
 	if (save_settings&CHARSAVE_QUEST)
@@ -928,6 +995,7 @@ static int quest_reload_check_sub(struct map_session_data *sd, va_list ap)
 	sd->num_quests = j;
 	ARR_FIND(0, sd->num_quests, i, sd->quest_log[i].state == Q_COMPLETE);
 	sd->avail_quests = i;
+	quest_build_kill_index(sd);
 
 	return 1;
 }
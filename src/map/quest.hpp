@@ -5,6 +5,7 @@
 #define QUEST_HPP
 
 #include <string>
+#include <vector>
 
 #include "../common/cbasetypes.hpp"
 #include "../common/database.hpp"
@@ -47,6 +48,41 @@ struct s_quest_db {
 	std::string name;
 };
 
+/// Kill objective of a quest in a player's quest log
+struct s_quest_kill_objective {
+	uint16 mob_id;                               ///< Monster ID, 0 for objectives matched by the other conditions
+	int index;                                   ///< Index of the quest in quest_log
+	uint8 objective;                             ///< Index of the objective in the quest
+	std::shared_ptr<s_quest_objective> data;
+};
+
+/// Drop bonus of a quest in a player's quest log
+struct s_quest_kill_drop {
+	uint16 mob_id;                               ///< Monster ID, 0 for any monster
+	std::shared_ptr<s_quest_dropitem> data;
+};
+
+/// Kill objectives and drop bonuses of a player's active and inactive quests
+/// Rebuilt whenever the quest log changes, so a kill only touches the entries it can match
+struct s_quest_kill_index {
+	std::vector<s_quest_kill_objective> objectives; ///< Objectives for a specific monster, sorted by monster ID
+	std::vector<s_quest_kill_objective> wildcards;  ///< Objectives matched by level, race, size, element, map or monster list
+	std::vector<s_quest_kill_drop> drops;           ///< Drop bonuses, sorted by monster ID
+
+	void clear() {
+		this->objectives.clear();
+		this->wildcards.clear();
+		this->drops.clear();
+	}
+
+	/// Frees the buffers as well, map_session_data is freed without running destructors
+	void release() {
+		std::vector<s_quest_kill_objective>().swap(this->objectives);
+		std::vector<s_quest_kill_objective>().swap(this->wildcards);
+		std::vector<s_quest_kill_drop>().swap(this->drops);
+	}
+};
+
 // Questlog check types
 enum e_quest_check_type : uint8 {
 	HAVEQUEST, ///< Query the state of the given quest
@@ -74,6 +110,7 @@ int quest_pc_login(struct map_session_data *sd);
 int quest_add(struct map_session_data *sd, int quest_id);
 int quest_delete(struct map_session_data *sd, int quest_id);
 int quest_change(struct map_session_data *sd, int qid1, int qid2);
+void quest_build_kill_index(struct map_session_data *sd);
 int quest_update_objective_sub(struct block_list *bl, va_list ap);
 void quest_update_objective(struct map_session_data *sd, struct mob_data* md);
 int quest_update_status(struct map_session_data *sd, int quest_id, e_quest_state status);
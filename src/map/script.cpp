@@ -73,6 +73,14 @@ unsigned int active_scripts;
 unsigned int next_id;
 struct eri *st_ers;
 struct eri *stack_ers;
+static struct eri *stack_data_ers;
+
+/// Number of stack entries a new script stack starts with, served by stack_data_ers
+#define SCRIPT_STACK_INITIAL 64
+
+struct script_stack_data_block {
+	struct script_data data[SCRIPT_STACK_INITIAL];
+};
 
 static bool script_rid2sd_( struct script_state *st, struct map_session_data** sd, const char *func );
 
@@ -3448,9 +3456,18 @@ int conv_num(struct script_state* st, struct script_data* data)
 /// Increases the size of the stack
 void stack_expand(struct script_stack* stack)
 {
-	stack->sp_max += 64;
-	stack->stack_data = (struct script_data*)aRealloc(stack->stack_data,
-			stack->sp_max * sizeof(stack->stack_data[0]) );
+	if( stack->sp_max == SCRIPT_STACK_INITIAL ) { // Leaving the pooled block, move over to the heap
+		struct script_data* data = (struct script_data*)aMalloc( ( stack->sp_max + 64 ) * sizeof(stack->stack_data[0]) );
+
+		memcpy(data, stack->stack_data, stack->sp_max * sizeof(stack->stack_data[0]));
+		ers_free(stack_data_ers, stack->stack_data);
+		stack->stack_data = data;
+		stack->sp_max += 64;
+	} else {
+		stack->sp_max += 64;
+		stack->stack_data = (struct script_data*)aRealloc(stack->stack_data,
+				stack->sp_max * sizeof(stack->stack_data[0]) );
+	}
 	memset(stack->stack_data + (stack->sp_max - 64), 0,
 			64 * sizeof(stack->stack_data[0]) );
 }
@@ -3629,8 +3646,9 @@ struct script_state* script_alloc_state(struct script_code* rootscript, int pos,
 	st = ers_alloc(st_ers, struct script_state);
 	st->stack = ers_alloc(stack_ers, struct script_stack);
 	st->stack->sp = 0;
-	st->stack->sp_max = 64;
-	CREATE(st->stack->stack_data, struct script_data, st->stack->sp_max);
+	st->stack->sp_max = SCRIPT_STACK_INITIAL;
+	st->stack->stack_data = ers_alloc(stack_data_ers, struct script_stack_data_block)->data;
+	memset(st->stack->stack_data, 0, st->stack->sp_max * sizeof(st->stack->stack_data[0]));
 	st->stack->defsp = st->stack->sp;
 	st->stack->scope.vars = i64db_alloc(DB_OPT_RELEASE_DATA);
 	st->stack->scope.arrays = NULL;
@@ -3688,7 +3706,10 @@ void script_free_state(struct script_state* st)
 			if (st->stack->scope.arrays)
 				st->stack->scope.arrays->destroy(st->stack->scope.arrays, script_free_array_db);
 			pop_stack(st, 0, st->stack->sp);
-			aFree(st->stack->stack_data);
+			if( st->stack->sp_max == SCRIPT_STACK_INITIAL )
+				ers_free(stack_data_ers, st->stack->stack_data);
+			else
+				aFree(st->stack->stack_data);
 			ers_free(stack_ers, st->stack);
 			st->stack = NULL;
 		}
@@ -4831,6 +4852,7 @@ void do_final_script() {
 
 	ers_destroy(st_ers);
 	ers_destroy(stack_ers);
+	ers_destroy(stack_data_ers);
 	db_destroy(st_db);
 }
 /*==========================================
@@ -4844,10 +4866,14 @@ void do_init_script(void) {
 
 	st_ers = ers_new(sizeof(struct script_state), "script.cpp::st_ers", ERS_CACHE_OPTIONS);
 	stack_ers = ers_new(sizeof(struct script_stack), "script.cpp::script_stack", ERS_OPT_FLEX_CHUNK);
+	stack_data_ers = ers_new(sizeof(struct script_stack_data_block), "script.cpp::stack_data_ers", ERS_OPT_FLEX_CHUNK);
 	array_ers = ers_new(sizeof(struct script_array), "script.cpp:array_ers", ERS_CLEAN_OPTIONS);
 
 	ers_chunk_size(st_ers, 10);
 	ers_chunk_size(stack_ers, 10);
+	ers_chunk_size(stack_data_ers, 10);
+
+	add_timer_func_list(run_script_timer, "run_script_timer");
 
 	active_scripts = 0;
 	next_id = 0;
@@ -19654,7 +19680,7 @@ BUILDIN_FUNC(unitwalk)
 		int x = script_getnum(st,3);
 		int y = script_getnum(st,4);
 
-		if (script_pushint(st, unit_can_reach_pos(bl,x,y,0))) {
+		if (script_pushint(st, unit_can_reach_pos(bl,x,y,0) || path_search_hpa(nullptr, nullptr, bl->m, bl->x, bl->y, x, y))) {
 			if (ud != nullptr)
 				ud->state.force_walk = true;
 			add_timer(gettick()+50, unit_delay_walktoxy_timer, bl->id, (x<<16)|(y&0xFFFF)); // Need timer to avoid mismatches
@@ -26745,6 +26771,9 @@ BUILDIN_FUNC(getfamerank) {
 
 	script_pushint(st, pc_famerank(sd->status.char_id, sd->class_ & MAPID_UPPERMASK));
 
+	return SCRIPT_CMD_SUCCESS;
+}
+
 /**
 * Generate item link string for client
 * itemlink(<item_id>,<refine>,<card0>,<card1>,<card2>,<card3>,<enchantgrade>{,<RandomIDArray>,<RandomValueArray>,<RandomParamArray>});
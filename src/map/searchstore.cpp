@@ -3,6 +3,10 @@
 
 #include "searchstore.hpp"  // struct s_search_store_info
 
+#include <algorithm>
+#include <unordered_map>
+#include <unordered_set>
+
 #include "../common/cbasetypes.hpp"
 #include "../common/malloc.hpp"  // aMalloc, aRealloc, aFree
 #include "../common/showmsg.hpp"  // ShowError, ShowWarning
@@ -10,6 +14,7 @@
 
 #include "battle.hpp"  // battle_config.*
 #include "clif.hpp"  // clif_open_search_store_info, clif_search_store_info_*
+#include "itemdb.hpp"  // itemdb_isspecial, itemdb_slots
 #include "pc.hpp"  // struct map_session_data
 
 /// Failure constants for clif functions
@@ -22,13 +27,6 @@ enum e_searchstore_failure
 	SSI_FAILED_SSILIST_CLICK_TO_OPEN_STORE = 4,  // "No sale (purchase) information available."
 };
 
-/// Search type constants
-enum e_searchstore_searchtype
-{
-	SEARCHTYPE_VENDING      = 0,
-	SEARCHTYPE_BUYING_STORE = 1,
-};
-
 /// Search effect constants
 enum e_searchstore_effecttype
 {
@@ -39,7 +37,15 @@ enum e_searchstore_effecttype
 
 /// Type for shop search function
 typedef bool (*searchstore_search_t)(struct map_session_data* sd, t_itemid nameid);
-typedef bool (*searchstore_searchall_t)(struct map_session_data* sd, const struct s_search_store_search* s);
+
+/// Index of all open stores of one search type
+struct s_searchstore_index {
+	std::unordered_map<t_itemid, std::vector<std::shared_ptr<s_search_store_info_item>>> items; // nameid -> entries, sorted by price
+	std::unordered_map<t_itemid, std::vector<std::shared_ptr<s_search_store_info_item>>> cards; // card id -> entries, sorted by price
+	std::unordered_map<uint32, std::vector<std::shared_ptr<s_search_store_info_item>>> stores; // account id -> entries
+};
+
+static s_searchstore_index searchstore_index[SEARCHTYPE_MAX];
 
 /**
  * Retrieves search function by type.
@@ -56,19 +62,124 @@ static searchstore_search_t searchstore_getsearchfunc(unsigned char type)
 	return NULL;
 }
 
+static bool searchstore_index_pricecmp(const std::shared_ptr<s_search_store_info_item>& entry, unsigned int price)
+{
+	return entry->price < price;
+}
+
 /**
- * Retrieves search-all function by type.
- * @param type : type of search to conduct
- * @return : search type
+ * Collects the card ids of an entry that a card search can match.
+ * @param entry : store entry
+ * @param cards : card ids found (without duplicates)
  */
-static searchstore_searchall_t searchstore_getsearchallfunc(unsigned char type)
+static void searchstore_index_getcards(const s_search_store_info_item& entry, std::vector<t_itemid>& cards)
 {
-	switch( type ) {
-		case SEARCHTYPE_VENDING:      return &vending_searchall;
-		case SEARCHTYPE_BUYING_STORE: return &buyingstore_searchall;
+	if( itemdb_isspecial(entry.card[0]) ) // something, that is not a carded
+		return;
+
+	int slot = min(itemdb_slots(entry.nameid), MAX_SLOTS);
+
+	for( int c = 0; c < slot && entry.card[c]; c++ ) {
+		if( std::find(cards.begin(), cards.end(), entry.card[c]) == cards.end() )
+			cards.push_back(entry.card[c]);
 	}
+}
 
-	return NULL;
+static void searchstore_index_insert(std::vector<std::shared_ptr<s_search_store_info_item>>& list, const std::shared_ptr<s_search_store_info_item>& entry)
+{
+	list.insert(std::upper_bound(list.begin(), list.end(), entry, [](const std::shared_ptr<s_search_store_info_item>& a, const std::shared_ptr<s_search_store_info_item>& b) { return a->price < b->price; }), entry);
+}
+
+static void searchstore_index_erase(std::unordered_map<t_itemid, std::vector<std::shared_ptr<s_search_store_info_item>>>& lists, t_itemid key, const std::shared_ptr<s_search_store_info_item>& entry)
+{
+	auto it = lists.find(key);
+
+	if( it == lists.end() )
+		return;
+
+	std::vector<std::shared_ptr<s_search_store_info_item>>& list = it->second;
+	auto pos = std::lower_bound(list.begin(), list.end(), entry->price, searchstore_index_pricecmp);
+
+	for( ; pos != list.end() && (*pos)->price == entry->price; pos++ ) {
+		if( *pos == entry ) {
+			list.erase(pos);
+			break;
+		}
+	}
+
+	if( list.empty() )
+		lists.erase(it);
+}
+
+/**
+ * Adds a store entry to the search index.
+ * Entries are snapshots, so the owning module re-adds its store whenever its amounts change.
+ * @param type : type of store
+ * @param entry : entry to add
+ */
+void searchstore_index_add(unsigned char type, std::shared_ptr<s_search_store_info_item> entry)
+{
+	if( type >= SEARCHTYPE_MAX || entry == nullptr )
+		return;
+
+	s_searchstore_index& index = searchstore_index[type];
+	std::vector<t_itemid> cards;
+
+	searchstore_index_insert(index.items[entry->nameid], entry);
+	searchstore_index_getcards(*entry, cards);
+	for( t_itemid card : cards )
+		searchstore_index_insert(index.cards[card], entry);
+	index.stores[entry->account_id].push_back(entry);
+}
+
+/**
+ * Removes all entries of a store from the search index.
+ * @param type : type of store
+ * @param account_id : account ID of the store owner
+ */
+void searchstore_index_remove(unsigned char type, uint32 account_id)
+{
+	if( type >= SEARCHTYPE_MAX )
+		return;
+
+	s_searchstore_index& index = searchstore_index[type];
+	auto store = index.stores.find(account_id);
+
+	if( store == index.stores.end() )
+		return;
+
+	for( const std::shared_ptr<s_search_store_info_item>& entry : store->second ) {
+		std::vector<t_itemid> cards;
+
+		searchstore_index_erase(index.items, entry->nameid, entry);
+		searchstore_index_getcards(*entry, cards);
+		for( t_itemid card : cards )
+			searchstore_index_erase(index.cards, card, entry);
+	}
+
+	index.stores.erase(store);
+}
+
+/**
+ * Collects the entries of a price sorted list within the given price range.
+ * @param list : price sorted entries
+ * @param min_price : minimum zeny price (0 = no limit)
+ * @param max_price : maximum zeny price (0 = no limit)
+ * @param filter : additional check every entry has to pass
+ * @param seen : entries already collected
+ * @param results : collected entries
+ */
+template <typename F> static void searchstore_index_collect(const std::vector<std::shared_ptr<s_search_store_info_item>>& list, unsigned int min_price, unsigned int max_price, F filter, std::unordered_set<s_search_store_info_item*>& seen, std::vector<std::shared_ptr<s_search_store_info_item>>& results)
+{
+	for( auto it = std::lower_bound(list.begin(), list.end(), min_price, searchstore_index_pricecmp); it != list.end(); it++ ) {
+		if( max_price && (*it)->price > max_price ) // too high price, so are all following entries
+			break;
+
+		if( !filter(**it) || !seen.insert(it->get()).second )
+			continue;
+
+		results.push_back(*it);
+	}
 }
 
 /**
@@ -141,10 +252,6 @@ bool searchstore_open(struct map_session_data* sd, unsigned int uses, unsigned s
 void searchstore_query(struct map_session_data* sd, unsigned char type, unsigned int min_price, unsigned int max_price, const struct PACKET_CZ_SEARCH_STORE_INFO_item* itemlist, unsigned int item_count, const struct PACKET_CZ_SEARCH_STORE_INFO_item* cardlist, unsigned int card_count)
 {
 	unsigned int i;
-	struct map_session_data* pl_sd;
-	struct DBIterator *iter;
-	struct s_search_store_search s;
-	searchstore_searchall_t store_searchall;
 	time_t querytime;
 
 	if( !battle_config.feature_search_stores )
@@ -153,7 +260,7 @@ void searchstore_query(struct map_session_data* sd, unsigned char type, unsigned
 	if( !sd->searchstore.open )
 		return;
 
-	if( ( store_searchall = searchstore_getsearchallfunc(type) ) == NULL ) {
+	if( type >= SEARCHTYPE_MAX ) {
 		ShowError("searchstore_query: Unknown search type %u (account_id=%d).\n", (unsigned int)type, sd->bl.id);
 		return;
 	}
@@ -197,26 +304,75 @@ void searchstore_query(struct map_session_data* sd, unsigned char type, unsigned
 	searchstore_clear(sd);
 
 	// search
-	s.search_sd  = sd;
-	s.itemlist   = itemlist;
-	s.cardlist   = cardlist;
-	s.item_count = item_count;
-	s.card_count = card_count;
-	s.min_price  = min_price;
-	s.max_price  = max_price;
-	iter         = db_iterator((type == SEARCHTYPE_VENDING) ? vending_getdb() : buyingstore_getdb());
-
-	for( pl_sd = (struct map_session_data*)dbi_first(iter); dbi_exists(iter);  pl_sd = (struct map_session_data*)dbi_next(iter) ) {
-		if( sd == pl_sd ) // skip own shop, if any
-			continue;
+	const s_searchstore_index& index = searchstore_index[type];
+	std::unordered_set<t_itemid> items, cards;
+	std::unordered_set<s_search_store_info_item*> seen;
+	std::vector<std::shared_ptr<s_search_store_info_item>> results;
+	size_t item_postings = 0, card_postings = 0;
 
-		if( !store_searchall(pl_sd, &s) ) { // exceeded result size
-			clif_search_store_info_failed(sd, SSI_FAILED_OVER_MAXCOUNT);
-			break;
+	for( i = 0; i < item_count; i++ ) {
+		auto it = index.items.find(itemlist[i].itemId);
+
+		if( it != index.items.end() && items.insert(itemlist[i].itemId).second )
+			item_postings += it->second.size();
+	}
+
+	// buying stores cannot contain cards, so the card list only filters vendings
+	if( type == SEARCHTYPE_VENDING ) {
+		for( i = 0; i < card_count; i++ ) {
+			auto it = index.cards.find(cardlist[i].itemId);
+
+			cards.insert(cardlist[i].itemId);
+			if( it != index.cards.end() )
+				card_postings += it->second.size();
+		}
+	}
+
+	if( !cards.empty() && card_postings < item_postings ) { // walk the (smaller) card lists and filter by item
+		auto filter = [sd, &items]( const s_search_store_info_item& entry ){
+			return entry.account_id != sd->status.account_id && items.find(entry.nameid) != items.end();
+		};
+
+		for( t_itemid card : cards ) {
+			auto it = index.cards.find(card);
+
+			if( it != index.cards.end() )
+				searchstore_index_collect(it->second, min_price, max_price, filter, seen, results);
 		}
+	} else {
+		auto filter = [sd, &cards]( const s_search_store_info_item& entry ){
+			if( entry.account_id == sd->status.account_id ) // skip own shop, if any
+				return false;
+
+			if( cards.empty() )
+				return true;
+
+			std::vector<t_itemid> entry_cards;
+
+			searchstore_index_getcards(entry, entry_cards);
+			for( t_itemid card : entry_cards ) {
+				if( cards.find(card) != cards.end() )
+					return true;
+			}
+
+			return false;
+		};
+
+		for( t_itemid nameid : items )
+			searchstore_index_collect(index.items.find(nameid)->second, min_price, max_price, filter, seen, results);
+	}
+
+	// cheapest offers first
+	std::stable_sort(results.begin(), results.end(), []( const std::shared_ptr<s_search_store_info_item>& a, const std::shared_ptr<s_search_store_info_item>& b ){
+		return a->price < b->price;
+	});
+
+	if( results.size() > (size_t)battle_config.searchstore_maxresults ) { // exceeded result size
+		results.resize(battle_config.searchstore_maxresults);
+		clif_search_store_info_failed(sd, SSI_FAILED_OVER_MAXCOUNT);
 	}
 
-	dbi_destroy(iter);
+	sd->searchstore.items = std::move(results);
 
 	if( !sd->searchstore.items.empty() ) {
 		// present results
@@ -376,3 +532,16 @@ void searchstore_clearremote(struct map_session_data* sd)
 {
 	sd->searchstore.remote_id = 0;
 }
+
+/**
+ * Clears the store search index.
+ * called in map::do_final
+ */
+void do_final_searchstore(void)
+{
+	for( s_searchstore_index& index : searchstore_index ) {
+		index.items.clear();
+		index.cards.clear();
+		index.stores.clear();
+	}
+}
@@ -15,15 +15,12 @@
 
 #define SEARCHSTORE_RESULTS_PER_PAGE 10
 
-/// information about the search being performed
-struct s_search_store_search {
-	struct map_session_data* search_sd;  // sd of the searching player
-	const struct PACKET_CZ_SEARCH_STORE_INFO_item* itemlist;
-	const struct PACKET_CZ_SEARCH_STORE_INFO_item* cardlist;
-	unsigned int item_count;
-	unsigned int card_count;
-	unsigned int min_price;
-	unsigned int max_price;
+/// Search type constants
+enum e_searchstore_searchtype
+{
+	SEARCHTYPE_VENDING      = 0,
+	SEARCHTYPE_BUYING_STORE = 1,
+	SEARCHTYPE_MAX
 };
 
 struct s_search_store_info_item {
@@ -58,5 +55,8 @@ void searchstore_close(struct map_session_data* sd);
 void searchstore_click(struct map_session_data* sd, uint32 account_id, int store_id, t_itemid nameid);
 bool searchstore_queryremote(struct map_session_data* sd, uint32 account_id);
 void searchstore_clearremote(struct map_session_data* sd);
+void searchstore_index_add(unsigned char type, std::shared_ptr<s_search_store_info_item> entry);
+void searchstore_index_remove(unsigned char type, uint32 account_id);
+void do_final_searchstore(void);
 
 #endif /* SEARCHSTORE_HPP */
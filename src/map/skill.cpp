@@ -4,11 +4,16 @@
 #include "skill.hpp"
 
 #include <array>
+#include <functional>
 #include <math.h>
+#include <queue>
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
 #include <time.h>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
 
 #include "../common/cbasetypes.hpp"
 #include "../common/ers.hpp"
@@ -56,6 +61,16 @@ static DBMap* bowling_db = NULL; // int mob_id -> struct mob_data*
 
 DBMap* skillunit_db = NULL; // int id -> struct skill_unit*
 
+/**
+ * Skill unit scheduling for skill_unit_timer.
+ * Units that have work to do on every pass (area checks, trap/HP state) are kept in skillunit_active.
+ * All others only matter once they expire and wait in skillunit_idle/skillunit_expiry until then.
+ * skillunit_expiry entries are lazy: an entry is stale if skillunit_idle no longer holds the same tick for the unit.
+ */
+static std::unordered_set<int> skillunit_active; // unit id
+static std::unordered_map<int, t_tick> skillunit_idle; // unit id -> expiry tick
+static std::priority_queue<std::pair<t_tick, int>, std::vector<std::pair<t_tick, int>>, std::greater<std::pair<t_tick, int>>> skillunit_expiry; // (expiry tick, unit id)
+
 /**
  * Skill Unit Persistency during endack routes (mostly for songs see bugreport:4574)
  */
@@ -119,12 +134,7 @@ uint16 skill_name2id(const char* name) {
 	if (name == nullptr)
 		return 0;
 
-	for (const auto &it : skill_db) {
-		if (strcmpi(it.second->name, name) == 0)
-			return it.first;
-	}
-
-	return 0;
+	return skill_db.searchname(name);
 }
 
 /**
@@ -4808,6 +4818,7 @@ static int skill_active_reverberation(struct block_list *bl, va_list ap) {
 		map_foreachinallrange(skill_trap_splash, bl, skill_get_splash(sg->skill_id, sg->skill_lv), sg->bl_flag, bl, gettick());
 		su->limit = DIFF_TICK(gettick(), sg->tick);
 		sg->unit_id = UNT_USED_TRAPS;
+		skill_unit_wake(su);
 	}
 	return 1;
 }
@@ -9886,6 +9897,7 @@ int skill_castend_nodamage_id (struct block_list *src, struct block_list *bl, ui
 						clif_changetraplook(bl, UNT_USED_TRAPS);
 						su->group->limit=DIFF_TICK(tick+1500,su->group->tick);
 						su->limit=DIFF_TICK(tick+1500,su->group->tick);
+						skill_unit_wake(su);
 				}
 			}
 		}
@@ -14993,6 +15005,8 @@ static int skill_unit_onplace(struct skill_unit *unit, struct block_list *bl, t_
 	if(bl->prev == NULL || !unit->alive || status_isdead(bl))
 		return 0;
 
+	skill_unit_wake(unit); // Limit or state of the group may change below
+
 	std::shared_ptr<s_skill_unit_group> sg = unit->group;
 
 	if (sg == nullptr)
@@ -15340,6 +15354,8 @@ int skill_unit_onplace_timer(struct skill_unit *unit, struct block_list *bl, t_t
 	if (bl->prev == NULL || !unit->alive || status_isdead(bl))
 		return 0;
 
+	skill_unit_wake(unit); // Limit or state of the group may change below
+
 	std::shared_ptr<s_skill_unit_group> sg = unit->group;
 
 	if (sg == nullptr)
@@ -16383,6 +16399,8 @@ int64 skill_unit_ondamaged(struct skill_unit *unit, int64 damage)
 	if (sg == nullptr)
 		return 0;
 
+	skill_unit_wake(unit);
+
 	switch( sg->unit_id ) {
 		case UNT_BLASTMINE:
 		case UNT_SKIDTRAP:
@@ -17053,15 +17071,10 @@ bool skill_check_condition_castbegin(struct map_session_data* sd, uint16 skill_i
 #endif
 		case CG_MOONLIT: //Check there's no wall in the range+1 area around the caster. [Skotlex]
 			{
-				int s,range = skill_get_splash(skill_id, skill_lv)+1;
-				int size = range*2+1;
-				for (s=0;s<size*size;s++) {
-					int x = sd->bl.x+(s%size-range);
-					int y = sd->bl.y+(s/size-range);
-					if (map_getcell(sd->bl.m,x,y,CELL_CHKWALL)) {
-						clif_skill_fail(sd,skill_id,USESKILL_FAIL_LEVEL,0);
-						return false;
-					}
+				int range = skill_get_splash(skill_id, skill_lv)+1;
+				if (map_getcellarea(sd->bl.m,sd->bl.x-range,sd->bl.y-range,sd->bl.x+range,sd->bl.y+range,CELL_CHKWALL)) {
+					clif_skill_fail(sd,skill_id,USESKILL_FAIL_LEVEL,0);
+					return false;
 				}
 			}
 			break;
@@ -17081,15 +17094,10 @@ bool skill_check_condition_castbegin(struct map_session_data* sd, uint16 skill_i
 			if( !sc || (sc && !sc->data[SC_BASILICA])) {
 				if( sd ) {
 					// When castbegin, needs 7x7 clear area
-					int s,range = skill_get_unit_layout_type(skill_id,skill_lv)+1;
-					int size = range*2+1;
-					for( s=0;s<size*size;s++ ) {
-						int x = sd->bl.x+(s%size-range);
-						int y = sd->bl.y+(s/size-range);
-						if( map_getcell(sd->bl.m,x,y,CELL_CHKWALL) ) {
-							clif_skill_fail(sd,skill_id,USESKILL_FAIL,0);
-							return false;
-						}
+					int range = skill_get_unit_layout_type(skill_id,skill_lv)+1;
+					if( map_getcellarea(sd->bl.m,sd->bl.x-range,sd->bl.y-range,sd->bl.x+range,sd->bl.y+range,CELL_CHKWALL) ) {
+						clif_skill_fail(sd,skill_id,USESKILL_FAIL,0);
+						return false;
 					}
 					if( map_foreachinallrange(skill_count_wos, &sd->bl, range, BL_MOB|BL_PC, &sd->bl) ) {
 						clif_skill_fail(sd,skill_id,USESKILL_FAIL,0);
@@ -19554,6 +19562,7 @@ int skill_detonator(struct block_list *bl, va_list ap)
 			group->unit_id = UNT_USED_TRAPS;
 			group->limit = DIFF_TICK(gettick(),group->tick) +
 				(unit_id == UNT_TALKIEBOX ? 5000 : (unit_id == UNT_CLUSTERBOMB || unit_id == UNT_ICEBOUNDTRAP? 2500 : (unit_id == UNT_FIRINGTRAP ? 0 : 1500)) );
+			skill_unit_wake(unit);
 			break;
 	}
 	return 0;
@@ -19592,6 +19601,7 @@ static int skill_bind_trap(struct block_list *bl, va_list ap) {
 	clif_changetraplook(bl, UNT_USED_TRAPS);
 	su->group->unit_id = UNT_USED_TRAPS;
 	su->group->limit = DIFF_TICK(gettick(), su->group->tick) + 500;
+	skill_unit_wake(su);
 	return 1;
 }
 
@@ -19847,6 +19857,7 @@ static int skill_trap_splash(struct block_list *bl, va_list ap)
 						clif_changetraplook(bl, UNT_USED_TRAPS);
 						su->group->limit = DIFF_TICK(gettick(),su->group->tick) + 1500;
 						su->group->unit_id = UNT_USED_TRAPS;
+						skill_unit_wake(su);
 						break;
 				}
 			}
@@ -20116,6 +20127,7 @@ struct skill_unit *skill_initunit(std::shared_ptr<s_skill_unit_group> group, int
 
 	// Stores new skill unit
 	idb_put(skillunit_db, unit->bl.id, unit);
+	skillunit_active.insert(unit->bl.id);
 	map_addiddb(&unit->bl);
 	if(map_addblock(&unit->bl))
 		return NULL;
@@ -20222,6 +20234,8 @@ int skill_delunit(struct skill_unit* unit)
 	map_delblock(&unit->bl); // don't free yet
 	map_deliddb(&unit->bl);
 	idb_remove(skillunit_db, unit->bl.id);
+	skillunit_active.erase(unit->bl.id);
+	skillunit_idle.erase(unit->bl.id);
 	if(--group->alive_count==0)
 		skill_delunitgroup(group);
 
@@ -20579,13 +20593,120 @@ int skill_unit_timer_sub_onplace(struct block_list* bl, va_list ap)
 }
 
 /**
- * @see DBApply
- * Sub function of skill_unit_timer for executing each skill unit from skillunit_db
+ * Check if a skill unit has to be processed on every skill_unit_timer pass
+ * @param unit: Skill unit
+ * @param group: Group of the unit
+ * @return True if the unit checks its area or its state before expiring, false if only expiration matters
  */
-static int skill_unit_timer_sub(DBKey key, DBData *data, va_list ap)
+static bool skill_unit_needs_poll(struct skill_unit *unit, std::shared_ptr<s_skill_unit_group> group)
+{
+	if (unit->range >= 0 && group->interval != -1)
+		return true;
+
+	switch (group->unit_id) {
+		case UNT_BLASTMINE:
+		case UNT_SKIDTRAP:
+		case UNT_LANDMINE:
+		case UNT_SHOCKWAVE:
+		case UNT_SANDMAN:
+		case UNT_FLASHER:
+		case UNT_CLAYMORETRAP:
+		case UNT_FREEZINGTRAP:
+		case UNT_TALKIEBOX:
+		case UNT_ANKLESNARE:
+		case UNT_B_TRAP:
+		case UNT_REVERBERATION:
+		case UNT_NETHERWORLD:
+		case UNT_WALLOFTHORN:
+		case UNT_SANCTUARY:
+			return true;
+	}
+
+	switch (group->skill_id) {
+		case WZ_METEOR:
+		case SU_CN_METEOR:
+		case SU_CN_METEOR2:
+		case AG_VIOLENT_QUAKE_ATK:
+		case AG_ALL_BLOOM_ATK:
+		case AG_ALL_BLOOM_ATK2:
+			return true;
+	}
+
+	return false;
+}
+
+/**
+ * Place a skill unit in the active set or park it until it expires
+ * @param unit: Skill unit
+ */
+static void skill_unit_schedule(struct skill_unit *unit)
+{
+	std::shared_ptr<s_skill_unit_group> group = unit->group;
+
+	if (group == nullptr || !unit->alive)
+		return;
+
+	if (skill_unit_needs_poll(unit, group)) {
+		skillunit_idle.erase(unit->bl.id);
+		skillunit_active.insert(unit->bl.id);
+		return;
+	}
+
+	skillunit_active.erase(unit->bl.id);
+
+	if (group->state.guildaura) { // Never expires, only woken up by external changes
+		skillunit_idle[unit->bl.id] = INFINITE_TICK;
+		return;
+	}
+
+	t_tick expire = group->tick + i64min(group->limit, unit->limit);
+
+	skillunit_idle[unit->bl.id] = expire;
+	skillunit_expiry.push(std::make_pair(expire, unit->bl.id));
+}
+
+/**
+ * Move all skill units of a group back to the active set so they are checked on the next skill_unit_timer pass
+ * @param group: Skill unit group
+ */
+void skill_unitgroup_wake(std::shared_ptr<s_skill_unit_group> group)
+{
+	if (group == nullptr || group->unit == nullptr)
+		return;
+
+	for (int i = 0; i < group->unit_count; i++) {
+		struct skill_unit *unit = &group->unit[i];
+
+		if (!unit->alive)
+			continue;
+
+		skillunit_idle.erase(unit->bl.id);
+		skillunit_active.insert(unit->bl.id);
+	}
+}
+
+/**
+ * Wake up the group of an idle skill unit.
+ * Must be called whenever a unit's limit or state is changed outside of skill_unit_timer.
+ * @param unit: Skill unit
+ */
+void skill_unit_wake(struct skill_unit *unit)
+{
+	nullpo_retv(unit);
+
+	if (skillunit_idle.find(unit->bl.id) == skillunit_idle.end())
+		return; // Already checked on every pass
+
+	skill_unitgroup_wake(unit->group);
+}
+
+/**
+ * Sub function of skill_unit_timer for executing a skill unit
+ * @param unit: Skill unit
+ * @param tick: Current tick
+ */
+static int skill_unit_timer_sub(struct skill_unit *unit, t_tick tick)
 {
-	struct skill_unit* unit = (struct skill_unit*)db_data2ptr(data);
-	t_tick tick = va_arg(ap,t_tick);
 	bool dissonance;
 	struct block_list* bl = &unit->bl;
 
@@ -20856,12 +20977,42 @@ static int skill_unit_timer_sub(DBKey key, DBData *data, va_list ap)
 }
 
 /*==========================================
- * Executes on all skill units every SKILLUNITTIMER_INTERVAL miliseconds.
+ * Executes on the active skill units every SKILLUNITTIMER_INTERVAL miliseconds.
+ * Idle units are only visited once their expiration tick is reached.
  *------------------------------------------*/
 TIMER_FUNC(skill_unit_timer){
 	map_freeblock_lock();
 
-	skillunit_db->foreach(skillunit_db, skill_unit_timer_sub, tick);
+	// Wake up idle units that expire now
+	while (!skillunit_expiry.empty() && DIFF_TICK(skillunit_expiry.top().first, tick) <= 0) {
+		std::pair<t_tick, int> entry = skillunit_expiry.top();
+
+		skillunit_expiry.pop();
+
+		auto it = skillunit_idle.find(entry.second);
+
+		if (it == skillunit_idle.end() || it->second != entry.first)
+			continue; // Stale entry, unit was woken up, rescheduled or deleted
+		skillunit_idle.erase(it);
+		skillunit_active.insert(entry.second);
+	}
+
+	std::vector<int> units(skillunit_active.begin(), skillunit_active.end());
+
+	for (const int &unit_id : units) {
+		struct skill_unit *unit = (struct skill_unit *)idb_get(skillunit_db, unit_id);
+
+		if (unit == nullptr) {
+			skillunit_active.erase(unit_id);
+			continue;
+		}
+
+		skill_unit_timer_sub(unit, tick);
+
+		// Unit might have been deleted while processing
+		if (unit->alive && unit->group != nullptr && idb_exists(skillunit_db, unit_id))
+			skill_unit_schedule(unit);
+	}
 
 	map_freeblock_unlock();
 	return 0;
@@ -24142,6 +24293,7 @@ void SkillDatabase::clear() {
 	TypesafeCachedYamlDatabase::clear();
 	memset( this->skilldb_id2idx, 0, sizeof( this->skilldb_id2idx ) );
 	this->skill_num = 1;
+	this->nameIndex.clear();
 }
 
 void SkillDatabase::loadingFinished(){
@@ -24149,9 +24301,41 @@ void SkillDatabase::loadingFinished(){
 		ShowError( "There are more skills defined in the skill database (%d) than the MAX_SKILL (%d) define. Please increase it and recompile.\n", this->skill_num, MAX_SKILL );
 	}
 
+	this->nameIndex.clear();
+
+	for( const auto &it : *this ){
+		this->nameIndex.add( it.second->name, it.first );
+	}
+
+	this->nameIndex.build();
+
 	TypesafeCachedYamlDatabase::loadingFinished();
 }
 
+/**
+ * Get skill id from name
+ * @param name: Skill name (case insensitive)
+ * @return Lowest ID of the skills with that name, or 0 if not found
+ */
+uint16 SkillDatabase::searchname( const char* name ){
+	if( this->nameIndex.empty() ){
+		// Still loading, the index is built when loading finished
+		for( const auto &it : *this ){
+			if( strcmpi( it.second->name, name ) == 0 ){
+				return it.first;
+			}
+		}
+
+		return 0;
+	}
+
+	std::vector<uint32> matches;
+
+	this->nameIndex.find_exact( name, matches );
+
+	return matches.empty() ? 0 : static_cast<uint16>( matches.front() );
+}
+
 /**
  * Get skill index from skill_db array. The index is also being used for skill lookup in mmo_charstatus::skill[]
  * @param skill_id
@@ -24713,6 +24897,8 @@ void do_init_skill(void)
 	add_timer_func_list(skill_castend_pos,"skill_castend_pos");
 	add_timer_func_list(skill_timerskill,"skill_timerskill");
 	add_timer_func_list(skill_blockpc_end, "skill_blockpc_end");
+	add_timer_func_list(skill_blockhomun_end, "skill_blockhomun_end");
+	add_timer_func_list(skill_blockmerc_end, "skill_blockmerc_end");
 	add_timer_func_list(skill_keep_using, "skill_keep_using");
 
 	add_timer_interval(gettick()+SKILLUNITTIMER_INTERVAL,skill_unit_timer,0,0,SKILLUNITTIMER_INTERVAL);
@@ -24727,6 +24913,9 @@ void do_final_skill(void)
 	skill_arrow_db.clear();
 
 	db_destroy(skillunit_db);
+	skillunit_active.clear();
+	skillunit_idle.clear();
+	skillunit_expiry = decltype(skillunit_expiry)();
 	db_destroy(skillusave_db);
 	db_destroy(bowling_db);
 	ers_destroy(skill_timer_ers);
@@ -311,6 +311,8 @@ private:
 	uint16 skilldb_id2idx[(UINT16_MAX + 1)];
 	/// Skill count, also as last index
 	uint16 skill_num;
+	/// Skill names for skill_name2id
+	rathena::util::name_index nameIndex;
 
 	template<typename T, size_t S> bool parseNode(const std::string& nodeName, const std::string& subNodeName, const ryml::NodeRef& node, T(&arr)[S]);
 
@@ -326,6 +328,7 @@ public:
 
 	// Additional
 	uint16 get_index( uint16 skill_id, bool silent, const char* func, const char* file, int line );
+	uint16 searchname( const char* name );
 };
 
 extern SkillDatabase skill_db;
@@ -575,6 +578,8 @@ void skill_clear_unitgroup(struct block_list *src);
 int skill_clear_group(block_list *bl, uint8 flag);
 void ext_skill_unit_onplace(struct skill_unit *unit, struct block_list *bl, t_tick tick);
 int64 skill_unit_ondamaged(struct skill_unit *unit,int64 damage);
+void skill_unit_wake(struct skill_unit *unit);
+void skill_unitgroup_wake(std::shared_ptr<s_skill_unit_group> group);
 
 // Skill unit visibility [Cydh]
 void skill_getareachar_skillunit_visibilty(struct skill_unit *su, enum send_target target);
@@ -30,6 +30,7 @@
 #include "mercenary.hpp"
 #include "mob.hpp"
 #include "npc.hpp"
+#include "party.hpp"
 #include "path.hpp"
 #include "pc.hpp"
 #include "pc_groups.hpp"
@@ -1407,6 +1408,9 @@ int status_damage(struct block_list *src,struct block_list *target,int64 dhp, in
 	if (!hp && !sp && !ap)
 		return 0;
 
+	if ((hp || sp) && target->type&BL_REGEN)
+		status_natural_heal_wake(target);
+
 	if( !status->hp )
 		flag |= 8;
 
@@ -5759,7 +5763,10 @@ void status_calc_bl_main(struct block_list *bl, std::bitset<SCB_MAX> flag)
 
 		if( status->hp > status->max_hp ) { // !FIXME: Should perhaps a status_zap should be issued?
 			status->hp = status->max_hp;
-			if( sd ) clif_updatestatus(sd,SP_HP);
+			if( sd ) {
+				clif_updatestatus(sd,SP_HP);
+				party_send_xy_mark(sd->status.party_id); // Update the HP of party members
+			}
 		}
 	}
 
@@ -6065,6 +6072,9 @@ void status_calc_bl_(struct block_list* bl, std::bitset<SCB_MAX> flag, uint8 opt
 
 	status_calc_bl_main(bl, flag);
 
+	if( bl->type&BL_REGEN )
+		status_natural_heal_wake(bl); // Max HP/SP or regen bonuses might have changed
+
 	if (opt&SCO_FIRST && bl->type == BL_HOM)
 		return; // Client update handled by caller
 
@@ -6155,8 +6165,10 @@ void status_calc_bl_(struct block_list* bl, std::bitset<SCB_MAX> flag, uint8 opt
 			clif_updatestatus(sd,SP_MAXHP);
 		if(b_status.max_sp != status->max_sp)
 			clif_updatestatus(sd,SP_MAXSP);
-		if(b_status.hp != status->hp)
+		if(b_status.hp != status->hp) {
 			clif_updatestatus(sd,SP_HP);
+			party_send_xy_mark(sd->status.party_id); // Update the HP of party members
+		}
 		if(b_status.sp != status->sp)
 			clif_updatestatus(sd,SP_SP);
 #ifdef RENEWAL
@@ -14866,10 +14878,20 @@ static int status_natural_heal(struct block_list* bl, va_list args)
 	if (!regen)
 		return 0;
 	status = status_get_status_data(bl);
+	sd = BL_CAST(BL_PC,bl);
+
+	// Nothing to recover, park it until it loses HP/SP or its status is recalculated
+	if (status->hp >= status->max_hp && status->sp >= status->max_sp &&
+		(!sd || !(sd->hp_loss.value || sd->sp_loss.value || sd->hp_regen.value || sd->sp_regen.value || sd->percent_hp_regen.value || sd->percent_sp_regen.value)))
+	{
+		regen->state.idle = 1;
+		map_setregen(bl, false);
+		return 0;
+	}
+
 	sc = status_get_sc(bl);
 	if (sc && !sc->count)
 		sc = NULL;
-	sd = BL_CAST(BL_PC,bl);
 
 	flag = regen->flag;
 	if (flag&RGN_HP && (regen->state.block&1))
@@ -15042,6 +15064,26 @@ static int status_natural_heal(struct block_list* bl, va_list args)
 	return flag;
 }
 
+/**
+ * Puts an object parked at full HP/SP back into the natural heal processing.
+ * The recovery intervals restart from the last processing tick, like for an object that was not regenerating.
+ * @param bl: Object to wake up [PC|HOM|MER|ELEM]
+ */
+void status_natural_heal_wake(struct block_list *bl)
+{
+	struct regen_data *regen = status_get_regen_data(bl);
+
+	if (!regen || !regen->state.idle)
+		return;
+	if (map_id2bl(bl->id) != bl)
+		return; // Not in the processing yet or anymore
+
+	regen->state.idle = 0;
+	regen->tick.hp = natural_heal_prev_tick;
+	regen->tick.sp = natural_heal_prev_tick;
+	map_setregen(bl, true);
+}
+
 /**
  * Natural heal main timer
  * @param tid: Timer ID
@@ -3113,6 +3113,7 @@ struct regen_data {
 		unsigned gc:1;	//Tags when you should have double regen due to GVG castle
 		unsigned overweight :2; //overweight state (1: 50%, 2: 90%)
 		unsigned block :2; //Block regen flag (1: Hp, 2: Sp)
+		unsigned idle :1; //Parked out of the natural heal processing at full HP/SP, see status_natural_heal_wake
 	} state;
 
 	//skill-regen, sitting-skill-regen (since not all chars with regen need it)
@@ -3353,6 +3354,7 @@ static void status_calc_bl(block_list *bl, std::vector<e_scb_flag> flags) {
 void status_calc_misc(struct block_list *bl, struct status_data *status, int level);
 void status_calc_regen(struct block_list *bl, struct status_data *status, struct regen_data *regen);
 void status_calc_regen_rate(struct block_list *bl, struct regen_data *regen, struct status_change *sc);
+void status_natural_heal_wake(struct block_list *bl);
 void status_calc_state(struct block_list *bl, struct status_change *sc, std::bitset<SCS_MAX> flag, bool start);
 
 void status_calc_slave_mode(struct mob_data *md, struct mob_data *mmd);
@@ -3,6 +3,8 @@
 
 #include "storage.hpp"
 
+#include <algorithm>
+#include <bitset>
 #include <map>
 
 #include <stdlib.h>
@@ -32,6 +34,17 @@ std::unordered_map<uint16, std::shared_ptr<struct s_storage_table>> storage_db;
 ///Databases of guild_storage : int guild_id -> struct guild_storage
 std::map<int, struct s_storage> guild_storage_db;
 
+/// Slot index of a storage, so adding and stacking items does not need to scan every slot
+struct s_storage_slot_index {
+	bool valid;
+	std::vector<t_itemid> nameids; ///< Item id of every slot, as last seen by the index
+	std::unordered_map<t_itemid, std::vector<uint16>> slots; ///< Item id -> occupied slots (ascending)
+	std::vector<uint64> free; ///< Bitmap of free slots
+};
+
+///Slot indexes of all storages in use : struct s_storage * -> struct s_storage_slot_index
+static std::unordered_map<const struct s_storage*, struct s_storage_slot_index> storage_slot_db;
+
 /**
  * Get storage name
  * @param id Storage ID
@@ -109,6 +122,7 @@ void do_final_storage(void)
 {
 	guild_storage_db.clear();
 	storage_db.clear();
+	storage_slot_db.clear();
 }
 
 /**
@@ -145,6 +159,7 @@ int storage_storageopen(struct map_session_data *sd)
 
 	sd->state.storage_flag = 1;
 	storage_sortitem(sd->storage.u.items_storage, ARRAYLENGTH(sd->storage.u.items_storage));
+	storage_slot_invalidate(&sd->storage);
 	clif_storagelist(sd, sd->storage.u.items_storage, ARRAYLENGTH(sd->storage.u.items_storage), storage_getName(0));
 	clif_updatestorageamount(sd, sd->storage.amount, sd->storage.max_amount);
 
@@ -178,6 +193,167 @@ int compare_item(struct item *a, struct item *b)
 	return 0;
 }
 
+/**
+ * Get the slot index of a storage, (re)building it if necessary
+ * @param stor : Storage data
+ * @return slot index
+ */
+static struct s_storage_slot_index& storage_slot_get(struct s_storage* stor)
+{
+	struct s_storage_slot_index& index = storage_slot_db[stor];
+
+	if( !index.valid ) {
+		uint16 size = sizeof(stor->u) / sizeof(stor->u.items_storage[0]);
+
+		index.nameids.assign(size, 0);
+		index.slots.clear();
+		index.free.assign((size + 63) / 64, 0);
+
+		for( uint16 i = 0; i < size; i++ ) {
+			t_itemid nameid = stor->u.items_storage[i].nameid;
+
+			index.nameids[i] = nameid;
+			if( nameid )
+				index.slots[nameid].push_back(i);
+			else
+				index.free[i / 64] |= 1ULL << (i % 64);
+		}
+
+		index.valid = true;
+	}
+
+	return index;
+}
+
+/**
+ * Get the slots holding an item
+ * @param stor : Storage data
+ * @param nameid : item id
+ * @return ascending list of slots or nullptr if the item is not in the storage
+ */
+const std::vector<uint16>* storage_slot_list(struct s_storage* stor, t_itemid nameid)
+{
+	struct s_storage_slot_index& index = storage_slot_get(stor);
+
+	return util::umap_find(index.slots, nameid);
+}
+
+/**
+ * Find the first free slot of a storage
+ * @param stor : Storage data
+ * @param limit : only slots below this index are considered
+ * @return index of the slot or -1 if there is no free slot
+ */
+int storage_slot_free(struct s_storage* stor, uint16 limit)
+{
+	struct s_storage_slot_index& index = storage_slot_get(stor);
+
+	for( size_t word = 0; word < index.free.size() && word * 64 < limit; word++ ) {
+		if( !index.free[word] )
+			continue;
+
+		for( uint16 bit = 0; bit < 64; bit++ ) {
+			if( !(index.free[word] & (1ULL << bit)) )
+				continue;
+
+			uint16 i = (uint16)(word * 64 + bit);
+
+			if( i >= limit )
+				return -1;
+
+			if( stor->u.items_storage[i].nameid ) { // changed without updating the index
+				storage_slot_invalidate(stor);
+				return storage_slot_free(stor, limit);
+			}
+
+			return i;
+		}
+	}
+
+	return -1;
+}
+
+/**
+ * Count the free slots of a storage
+ * @param stor : Storage data
+ * @param limit : only slots below this index are counted
+ * @return number of free slots
+ */
+uint16 storage_slot_freecount(struct s_storage* stor, uint16 limit)
+{
+	struct s_storage_slot_index& index = storage_slot_get(stor);
+	uint16 count = 0;
+
+	for( size_t word = 0; word < index.free.size() && word * 64 < limit; word++ ) {
+		uint64 bits = index.free[word];
+
+		if( (word + 1) * 64 > limit )
+			bits &= (1ULL << (limit % 64)) - 1;
+
+		count += (uint16)std::bitset<64>(bits).count();
+	}
+
+	return count;
+}
+
+/**
+ * Update the slot index after the item of a slot was added, replaced or removed
+ * @param stor : Storage data
+ * @param i : index of the slot
+ */
+void storage_slot_update(struct s_storage* stor, uint16 i)
+{
+	struct s_storage_slot_index* index = util::umap_find(storage_slot_db, (const struct s_storage*)stor);
+
+	if( index == nullptr || !index->valid ) // will be built on next use
+		return;
+
+	t_itemid nameid = stor->u.items_storage[i].nameid;
+	t_itemid previous = index->nameids[i];
+
+	if( nameid == previous )
+		return;
+
+	if( previous ) {
+		std::vector<uint16>& slots = index->slots[previous];
+
+		slots.erase(std::lower_bound(slots.begin(), slots.end(), i));
+		if( slots.empty() )
+			index->slots.erase(previous);
+	}
+
+	if( nameid ) {
+		std::vector<uint16>& slots = index->slots[nameid];
+
+		slots.insert(std::lower_bound(slots.begin(), slots.end(), i), i);
+		index->free[i / 64] &= ~(1ULL << (i % 64));
+	} else
+		index->free[i / 64] |= 1ULL << (i % 64);
+
+	index->nameids[i] = nameid;
+}
+
+/**
+ * Mark the slot index of a storage outdated, after the whole storage was loaded or sorted
+ * @param stor : Storage data
+ */
+void storage_slot_invalidate(struct s_storage* stor)
+{
+	struct s_storage_slot_index* index = util::umap_find(storage_slot_db, (const struct s_storage*)stor);
+
+	if( index != nullptr )
+		index->valid = false;
+}
+
+/**
+ * Remove the slot index of a storage that is no longer used
+ * @param stor : Storage data
+ */
+void storage_slot_release(struct s_storage* stor)
+{
+	storage_slot_db.erase(stor);
+}
+
 /**
  * Check if item can be added to storage
  * @param stor Storage data
@@ -263,17 +439,17 @@ static int storage_additem(struct map_session_data* sd, struct s_storage *stor,
 	}
 
 	if( itemdb_isstackable2(data) ) { // Stackable
-		for( i = 0; i < stor->max_amount; i++ ) {
-			if( compare_item(&stor->u.items_storage[i], it) ) { // existing items found, stack them
-				if( amount > MAX_AMOUNT - stor->u.items_storage[i].amount || ( data->stack.storage && amount > data->stack.amount - stor->u.items_storage[i].amount ) )
-					return 2;
+		i = storage_slot_find(stor, it->nameid, stor->max_amount, [it]( struct item& slot ) { return compare_item(&slot, it) != 0; });
 
-				stor->u.items_storage[i].amount += amount;
-				stor->dirty = true;
-				clif_storageitemadded(sd,&stor->u.items_storage[i],i,amount);
+		if( i >= 0 ) { // existing items found, stack them
+			if( amount > MAX_AMOUNT - stor->u.items_storage[i].amount || ( data->stack.storage && amount > data->stack.amount - stor->u.items_storage[i].amount ) )
+				return 2;
 
-				return 0;
-			}
+			stor->u.items_storage[i].amount += amount;
+			stor->dirty = true;
+			clif_storageitemadded(sd,&stor->u.items_storage[i],i,amount);
+
+			return 0;
 		}
 	}
 
@@ -281,12 +457,12 @@ static int storage_additem(struct map_session_data* sd, struct s_storage *stor,
 		return 2;
 
 	// find free slot
-	ARR_FIND( 0, stor->max_amount, i, stor->u.items_storage[i].nameid == 0 );
-	if( i >= stor->max_amount )
+	if( ( i = storage_slot_free(stor, stor->max_amount) ) < 0 )
 		return 2;
 
 	// add item to slot
 	memcpy(&stor->u.items_storage[i],it,sizeof(stor->u.items_storage[0]));
+	storage_slot_update(stor, i);
 	stor->amount++;
 	stor->u.items_storage[i].amount = amount;
 	stor->dirty = true;
@@ -313,6 +489,7 @@ int storage_delitem(struct map_session_data* sd, struct s_storage *stor, int ind
 
 	if( stor->u.items_storage[index].amount == 0 ) {
 		memset(&stor->u.items_storage[index],0,sizeof(stor->u.items_storage[0]));
+		storage_slot_update(stor, index);
 		stor->amount--;
 		if( sd->state.storage_flag == 1 || sd->state.storage_flag == 3 )
 			clif_updatestorageamount(sd, stor->amount, stor->max_amount);
@@ -475,8 +652,11 @@ void storage_storageclose(struct map_session_data *sd)
 	if (sd->storage.dirty) {
 		if (save_settings&CHARSAVE_STORAGE)
 			chrif_save(sd, CSAVE_INVENTORY|CSAVE_CART);
-		else
+		else {
 			storage_storagesave(sd);
+			// Inventory is only saved with the character, do not leave it behind for a whole cycle
+			pc_autosave_prioritize(sd);
+		}
 	}
 	
 	if( sd->state.storage_flag == 1 ){
@@ -543,6 +723,10 @@ struct s_storage *guild2storage2(int guild_id){
  */
 void storage_guild_delete(int guild_id)
 {
+	struct s_storage* stor = guild2storage2(guild_id);
+
+	if( stor != nullptr )
+		storage_slot_release(stor);
 	guild_storage_db.erase(guild_id);
 }
 
@@ -600,6 +784,7 @@ char storage_guild_storageopen(struct map_session_data* sd)
 	gstor->status = true;
 	sd->state.storage_flag = 2;
 	storage_sortitem(gstor->u.items_guild, ARRAYLENGTH(gstor->u.items_guild));
+	storage_slot_invalidate(gstor);
 	clif_storagelist(sd, gstor->u.items_guild, ARRAYLENGTH(gstor->u.items_guild), "Guild Storage");
 	clif_updatestorageamount(sd, gstor->amount, gstor->max_amount);
 
@@ -753,28 +938,28 @@ bool storage_guild_additem(struct map_session_data* sd, struct s_storage* stor,
 	}
 
 	if(itemdb_isstackable2(id)) { //Stackable
-		for(i = 0; i < stor->max_amount; i++) {
-			if(compare_item(&stor->u.items_guild[i], item_data)) {
-				if( amount > MAX_AMOUNT - stor->u.items_guild[i].amount || ( id->stack.guild_storage && amount > id->stack.amount - stor->u.items_guild[i].amount ) )
-					return false;
+		i = storage_slot_find(stor, item_data->nameid, stor->max_amount, [item_data]( struct item& slot ) { return compare_item(&slot, item_data) != 0; });
 
-				stor->u.items_guild[i].amount += amount;
-				clif_storageitemadded(sd,&stor->u.items_guild[i],i,amount);
-				stor->dirty = true;
+		if( i >= 0 ) {
+			if( amount > MAX_AMOUNT - stor->u.items_guild[i].amount || ( id->stack.guild_storage && amount > id->stack.amount - stor->u.items_guild[i].amount ) )
+				return false;
 
-				storage_guild_log( sd, &stor->u.items_guild[i], amount );
+			stor->u.items_guild[i].amount += amount;
+			clif_storageitemadded(sd,&stor->u.items_guild[i],i,amount);
+			stor->dirty = true;
 
-				return true;
-			}
+			storage_guild_log( sd, &stor->u.items_guild[i], amount );
+
+			return true;
 		}
 	}
 
 	//Add item
-	for(i = 0; i < stor->max_amount && stor->u.items_guild[i].nameid; i++);
-	if(i >= stor->max_amount)
+	if( ( i = storage_slot_free(stor, stor->max_amount) ) < 0 )
 		return false;
 
 	memcpy(&stor->u.items_guild[i],item_data,sizeof(stor->u.items_guild[0]));
+	storage_slot_update(stor, i);
 	stor->u.items_guild[i].amount = amount;
 	stor->amount++;
 	clif_storageitemadded(sd,&stor->u.items_guild[i],i,amount);
@@ -808,25 +993,25 @@ bool storage_guild_additem2(struct s_storage* stor, struct item* item, int amoun
 		return false;
 
 	if (itemdb_isstackable2(id.get())) { // Stackable
-		for (i = 0; i < stor->max_amount; i++) {
-			if (compare_item(&stor->u.items_guild[i], item)) {
-				// Set the amount, make it fit with max amount
-				amount = min(amount, ((id->stack.guild_storage) ? id->stack.amount : MAX_AMOUNT) - stor->u.items_guild[i].amount);
-				if (amount != item->amount)
-					ShowWarning("storage_guild_additem2: Stack limit reached! Altered amount of item \"" CL_WHITE "%s" CL_RESET "\" (%u). '" CL_WHITE "%d" CL_RESET "' -> '" CL_WHITE"%d" CL_RESET "'.\n", id->name.c_str(), id->nameid, item->amount, amount);
-				stor->u.items_guild[i].amount += amount;
-				stor->dirty = true;
-				return true;
-			}
+		i = storage_slot_find(stor, item->nameid, stor->max_amount, [item]( struct item& slot ) { return compare_item(&slot, item) != 0; });
+
+		if (i >= 0) {
+			// Set the amount, make it fit with max amount
+			amount = min(amount, ((id->stack.guild_storage) ? id->stack.amount : MAX_AMOUNT) - stor->u.items_guild[i].amount);
+			if (amount != item->amount)
+				ShowWarning("storage_guild_additem2: Stack limit reached! Altered amount of item \"" CL_WHITE "%s" CL_RESET "\" (%u). '" CL_WHITE "%d" CL_RESET "' -> '" CL_WHITE"%d" CL_RESET "'.\n", id->name.c_str(), id->nameid, item->amount, amount);
+			stor->u.items_guild[i].amount += amount;
+			stor->dirty = true;
+			return true;
 		}
 	}
 
 	// Add the item
-	for (i = 0; i < stor->max_amount && stor->u.items_guild[i].nameid; i++);
-	if (i >= stor->max_amount)
+	if ((i = storage_slot_free(stor, stor->max_amount)) < 0)
 		return false;
 
 	memcpy(&stor->u.items_guild[i], item, sizeof(stor->u.items_guild[0]));
+	storage_slot_update(stor, i);
 	stor->u.items_guild[i].amount = amount;
 	stor->amount++;
 	stor->dirty = true;
@@ -856,6 +1041,7 @@ bool storage_guild_delitem(struct map_session_data* sd, struct s_storage* stor,
 
 	if(!stor->u.items_guild[n].amount) {
 		memset(&stor->u.items_guild[n],0,sizeof(stor->u.items_guild[0]));
+		storage_slot_update(stor, n);
 		stor->amount--;
 		clif_updatestorageamount(sd, stor->amount, stor->max_amount);
 	}
@@ -1118,6 +1304,7 @@ void storage_premiumStorage_open(struct map_session_data *sd) {
 
 	sd->state.storage_flag = 3;
 	storage_sortitem(sd->premiumStorage.u.items_storage, ARRAYLENGTH(sd->premiumStorage.u.items_storage));
+	storage_slot_invalidate(&sd->premiumStorage);
 	clif_storagelist(sd, sd->premiumStorage.u.items_storage, ARRAYLENGTH(sd->premiumStorage.u.items_storage), storage_getName(sd->premiumStorage.stor_id));
 	clif_updatestorageamount(sd, sd->premiumStorage.amount, sd->premiumStorage.max_amount);
 }
@@ -92,4 +92,43 @@ void storage_premiumStorage_quit(struct map_session_data *sd);
 
 int compare_item(struct item *a, struct item *b);
 
+// Slot index
+const std::vector<uint16>* storage_slot_list(struct s_storage* stor, t_itemid nameid);
+int storage_slot_free(struct s_storage* stor, uint16 limit);
+uint16 storage_slot_freecount(struct s_storage* stor, uint16 limit);
+void storage_slot_update(struct s_storage* stor, uint16 index);
+void storage_slot_invalidate(struct s_storage* stor);
+void storage_slot_release(struct s_storage* stor);
+
+/**
+ * Finds the first slot holding an item that passes the given check, without scanning the whole storage
+ * @param stor : Storage data
+ * @param nameid : item id to look for
+ * @param limit : only slots below this index are considered
+ * @param match : check for the item in a slot
+ * @return index of the slot or -1 if not found
+ */
+template <typename F> int storage_slot_find(struct s_storage* stor, t_itemid nameid, uint16 limit, F match)
+{
+	const std::vector<uint16>* slots = storage_slot_list(stor, nameid);
+
+	if( slots == nullptr )
+		return -1;
+
+	for( uint16 i : *slots ) {
+		if( i >= limit )
+			break;
+
+		if( stor->u.items_storage[i].nameid != nameid ) { // changed without updating the index
+			storage_slot_invalidate(stor);
+			return storage_slot_find(stor, nameid, limit, match);
+		}
+
+		if( match(stor->u.items_storage[i]) )
+			return i;
+	}
+
+	return -1;
+}
+
 #endif /* STORAGE_HPP */
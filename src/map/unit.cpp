@@ -6,6 +6,8 @@
 #include <stdlib.h>
 #include <string.h>
 
+#include <algorithm>
+
 #include "../common/db.hpp"
 #include "../common/ers.hpp"  // ers_destroy
 #include "../common/malloc.hpp"
@@ -44,6 +46,8 @@ using namespace rathena;
 	#define MAX_SHADOW_SCAR 100 /// Max Shadow Scars
 #endif
 
+#define MAX_WAYPOINT_DISTANCE 14 /// Cells walked between two waypoints of a long walk (see OFFICIAL_WALKPATH)
+
 // Directions values
 // 1 0 7
 // 2 . 6
@@ -472,7 +476,7 @@ static TIMER_FUNC(unit_walktoxy_timer)
 	map_foreachinmovearea(clif_insight, bl, AREA_SIZE, -dx, -dy, sd?BL_ALL:BL_PC, bl);
 	ud->walktimer = INVALID_TIMER;
 
-	if (bl->x == ud->to_x && bl->y == ud->to_y) {
+	if (bl->x == ud->to_x && bl->y == ud->to_y && ud->walk_waypoints.empty()) {
 #if PACKETVER >= 20170726
 		// If this was a walking NPC and it used a player sprite
 		if( bl->type == BL_NPC && pcdb_checkid( status_get_viewdata( bl )->class_ ) ){
@@ -614,6 +618,14 @@ static TIMER_FUNC(unit_walktoxy_timer)
 		ud->walktimer = add_timer(tick+speed,unit_walktoxy_timer,id,speed);
 		if( md && DIFF_TICK(tick,md->dmgtick) < 3000 ) // Not required not damaged recently
 			clif_move(ud);
+	} else if (!ud->walk_waypoints.empty()) { // Continue with the next leg of a long walk
+		s_path_cell waypoint = ud->walk_waypoints.back();
+
+		ud->walk_waypoints.pop_back();
+
+		// Each leg goes through the same can_move checks as a normal walk
+		if (!unit_walktoxy(bl, waypoint.x, waypoint.y, ud->state.walk_easy|16))
+			ud->walk_waypoints.clear();
 	} else if(ud->state.running) { // Keep trying to run.
 		if (!(unit_run(bl, NULL, SC_RUN) || unit_run(bl, sd, SC_WUGDASH)) )
 			ud->state.running = 0;
@@ -679,7 +691,12 @@ TIMER_FUNC(unit_delay_walktoxy_timer){
 	if (!bl || bl->prev == NULL)
 		return 0;
 
-	unit_walktoxy(bl, (short)((data>>16)&0xffff), (short)(data&0xffff), 0);
+	short x = (short)((data>>16)&0xffff), y = (short)(data&0xffff);
+	struct unit_data *ud = unit_bl2ud(bl);
+
+	// Script driven walks may target cells that are out of reach for a single walk path
+	if (!unit_walktoxy(bl, x, y, 0) && ud != nullptr && ud->state.force_walk)
+		unit_walktoxy_long(bl, x, y, 0);
 
 	return 1;
 }
@@ -717,6 +734,7 @@ TIMER_FUNC(unit_delay_walktobl_timer){
  *	&2: Force walking (override can_move)
  *	&4: Delay walking for can_move
  *	&8: Search for an unoccupied cell and cancel if none available
+ *	&16: Keep the remaining waypoints of a long walk
  * @return 1: Success 0: Fail or unit_walktoxy_sub()
  */
 int unit_walktoxy( struct block_list *bl, short x, short y, unsigned char flag)
@@ -763,6 +781,9 @@ int unit_walktoxy( struct block_list *bl, short x, short y, unsigned char flag)
 	if(!(flag&2) && (!status_bl_has_mode(bl,MD_CANMOVE) || !unit_can_move(bl)))
 		return 0;
 
+	if (!(flag&16))
+		ud->walk_waypoints.clear();
+
 	ud->state.walk_easy = flag&1;
 	ud->to_x = x;
 	ud->to_y = y;
@@ -796,6 +817,51 @@ int unit_walktoxy( struct block_list *bl, short x, short y, unsigned char flag)
 	return unit_walktoxy_sub(bl);
 }
 
+/**
+ * Walks a unit to a coordinate that is out of reach for a single walk path
+ * The route is taken from the hierarchical path search and walked leg by leg,
+ * every leg being a regular unit_walktoxy call
+ * @param bl: Object to send to x,y coordinate
+ * @param x: X coordinate where the object will be walking to
+ * @param y: Y coordinate where the object will be walking to
+ * @param flag: Parameter to decide how to walk (see unit_walktoxy)
+ * @return 1: Success 0: Fail
+ */
+int unit_walktoxy_long(struct block_list *bl, short x, short y, unsigned char flag)
+{
+	nullpo_ret(bl);
+
+	unit_data *ud = unit_bl2ud(bl);
+
+	if (ud == nullptr)
+		return 0;
+
+	std::vector<s_path_cell> path;
+
+	if (!path_search_hpa(&path, nullptr, bl->m, bl->x, bl->y, x, y) || path.empty())
+		return 0;
+
+	std::vector<s_path_cell> waypoints;
+
+	for (size_t i = MAX_WAYPOINT_DISTANCE; i < path.size(); i += MAX_WAYPOINT_DISTANCE)
+		waypoints.push_back(path[i - 1]);
+	waypoints.push_back(path.back());
+
+	// The next waypoint is taken from the back
+	std::reverse(waypoints.begin(), waypoints.end());
+
+	s_path_cell waypoint = waypoints.back();
+
+	waypoints.pop_back();
+
+	if (!unit_walktoxy(bl, waypoint.x, waypoint.y, flag&~16))
+		return 0;
+
+	ud->walk_waypoints = waypoints;
+
+	return 1;
+}
+
 /**
  * Sets a mob's CHASE/FOLLOW state
  * This should not be done if there's no path to reach
@@ -1397,6 +1463,7 @@ int unit_stop_walking(struct block_list *bl,int type)
 		ud->walktimer = INVALID_TIMER;
 	}
 	ud->state.change_walk_target = 0;
+	ud->walk_waypoints.clear();
 	tick = gettick();
 
 	if( (type&USW_MOVE_ONCE && !ud->walkpath.path_pos) // Force moving at least one cell.
@@ -3417,6 +3484,10 @@ int unit_free(struct block_list *bl, clr_type clrtype)
 			guild_send_memberinfoshort(sd,0);
 			pc_cleareventtimer(sd);
 			pc_inventory_rental_clear(sd);
+			storage_slot_release(&sd->inventory);
+			storage_slot_release(&sd->cart);
+			storage_slot_release(&sd->storage);
+			storage_slot_release(&sd->premiumStorage);
 			pc_delspiritball(sd, sd->spiritball, 1);
 			pc_delspiritcharm(sd, sd->spiritcharm, sd->spiritcharm_type);
 
@@ -3443,6 +3514,8 @@ int unit_free(struct block_list *bl, clr_type clrtype)
 				sd->num_quests = sd->avail_quests = 0;
 			}
 
+			sd->quest_kill_index.release();
+
 			sd->qi_display.clear();
 
 #if PACKETVER_MAIN_NUM >= 20150507 || PACKETVER_RE_NUM >= 20150429 || defined(PACKETVER_ZERO)
@@ -3703,6 +3776,7 @@ void do_init_unit(void){
 	add_timer_func_list(unit_delay_walktobl_timer,"unit_delay_walktobl_timer");
 	add_timer_func_list(unit_teleport_timer,"unit_teleport_timer");
 	add_timer_func_list(unit_step_timer,"unit_step_timer");
+	add_timer_func_list(unit_resume_running,"unit_resume_running");
 	add_timer_func_list(unit_shadowscar_timer, "unit_shadowscar_timer");
 }
 
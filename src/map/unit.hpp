@@ -7,7 +7,7 @@
 #include "../common/cbasetypes.hpp"
 #include "../common/timer.hpp"
 
-#include "path.hpp" // struct walkpath_data
+#include "path.hpp" // struct walkpath_data, struct s_path_cell
 #include "skill.hpp" // struct skill_timerskill, struct skill_unit_group, struct skill_unit_group_tickset
 
 enum sc_type : int16;
@@ -65,6 +65,7 @@ struct unit_data {
 	int32 group_id;
 
 	std::vector<int> shadow_scar_timer;
+	std::vector<s_path_cell> walk_waypoints; ///< Remaining waypoints of a long walk, next one last
 };
 
 struct view_data {
@@ -109,6 +110,7 @@ enum e_unit_stop_walking {
 
 // Does walk action for unit
 int unit_walktoxy(struct block_list *bl, short x, short y, unsigned char flag);
+int unit_walktoxy_long(struct block_list *bl, short x, short y, unsigned char flag);
 int unit_walktobl(struct block_list *bl, struct block_list *target, int range, unsigned char flag);
 void unit_run_hit(struct block_list *bl, struct status_change *sc, struct map_session_data *sd, enum sc_type type);
 bool unit_run(struct block_list *bl, struct map_session_data *sd, enum sc_type type);
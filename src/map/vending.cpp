@@ -24,6 +24,7 @@
 #include "path.hpp"
 #include "pc.hpp"
 #include "pc_groups.hpp"
+#include "searchstore.hpp"
 
 static uint32 vending_nextid = 0; ///Vending_id counter
 static DBMap *vending_db; ///DB holder the vender : charid -> map_session_data
@@ -31,6 +32,7 @@ static DBMap *vending_db; ///DB holder the vender : charid -> map_session_data
 //Autotrader
 static DBMap *vending_autotrader_db; /// Holds autotrader info: char_id -> struct s_autotrader
 static void vending_autotrader_remove(struct s_autotrader *at, bool remove);
+static void vending_searchstore_index(struct map_session_data* sd);
 static int vending_autotrader_free(DBKey key, DBData *data, va_list ap);
 
 /**
@@ -69,6 +71,7 @@ void vending_closevending(struct map_session_data* sd)
 		sd->vender_id = 0;
 		clif_closevendingboard(&sd->bl, 0);
 		idb_remove(vending_db, sd->status.char_id);
+		searchstore_index_remove(SEARCHTYPE_VENDING, sd->status.account_id);
 	}
 }
 
@@ -266,6 +269,7 @@ void vending_purchasereq(struct map_session_data* sd, int aid, int uid, const ui
 	}
 
 	vsd->vend_num = cursor;
+	vending_searchstore_index(vsd);
 
 	//Always save BOTH: customer (buyer) and vender
 	if( save_settings&CHARSAVE_VENDING ) {
@@ -391,6 +395,7 @@ int8 vending_openvending(struct map_session_data* sd, const char* message, const
 	clif_showvendingboard( *sd );
 
 	idb_put(vending_db, sd->status.char_id, sd);
+	vending_searchstore_index(sd);
 
 	return 0;
 }
@@ -418,57 +423,21 @@ bool vending_search(struct map_session_data* sd, t_itemid nameid)
 }
 
 /**
- * Searches for all items in a vending, that match given ids, price and possible cards.
- * @param sd : The vender session to search into
- * @param s : parameter of the search (see s_search_store_search)
- * @return Whether or not the search should be continued.
+ * Refreshes the search store index entries of a vending.
+ * @param sd : The vender session to index
  */
-bool vending_searchall(struct map_session_data* sd, const struct s_search_store_search* s)
+static void vending_searchstore_index(struct map_session_data* sd)
 {
-	int i, c, slot;
-	unsigned int idx, cidx;
-	struct item* it;
+	searchstore_index_remove(SEARCHTYPE_VENDING, sd->status.account_id);
 
 	if( !sd->state.vending ) // not vending
-		return true;
+		return;
 
-	for( idx = 0; idx < s->item_count; idx++ ) {
-		ARR_FIND( 0, sd->vend_num, i, sd->cart.u.items_cart[sd->vending[i].index].nameid == s->itemlist[idx].itemId );
-		if( i == sd->vend_num ) { // not found
-			continue;
-		}
-		it = &sd->cart.u.items_cart[sd->vending[i].index];
+	for( int i = 0; i < sd->vend_num; i++ ) {
+		struct item* it = &sd->cart.u.items_cart[sd->vending[i].index];
 
-		if( s->min_price && s->min_price > sd->vending[i].value ) { // too low price
+		if( !sd->vending[i].amount )
 			continue;
-		}
-
-		if( s->max_price && s->max_price < sd->vending[i].value ) { // too high price
-			continue;
-		}
-
-		if( s->card_count ) { // check cards
-			if( itemdb_isspecial(it->card[0]) ) { // something, that is not a carded
-				continue;
-			}
-			slot = itemdb_slots(it->nameid);
-
-			for( c = 0; c < slot && it->card[c]; c ++ ) {
-				ARR_FIND( 0, s->card_count, cidx, s->cardlist[cidx].itemId == it->card[c] );
-				if( cidx != s->card_count ) { // found
-					break;
-				}
-			}
-
-			if( c == slot || !it->card[c] ) { // no card match
-				continue;
-			}
-		}
-
-		// Check if the result set is full
-		if( s->search_sd->searchstore.items.size() >= (unsigned int)battle_config.searchstore_maxresults ){
-			return false;
-		}
 
 		std::shared_ptr<s_search_store_info_item> ssitem = std::make_shared<s_search_store_info_item>();
 
@@ -484,10 +453,8 @@ bool vending_searchall(struct map_session_data* sd, const struct s_search_store_
 		ssitem->refine = it->refine;
 		ssitem->enchantgrade = it->enchantgrade;
 
-		s->search_sd->searchstore.items.push_back( ssitem );
+		searchstore_index_add(SEARCHTYPE_VENDING, ssitem);
 	}
-
-	return true;
 }
 
 /**
@@ -9,7 +9,6 @@
 #include "../common/mmo.hpp"
 
 struct map_session_data;
-struct s_search_store_search;
 struct s_autotrader;
 
 struct s_vending {
@@ -29,7 +28,6 @@ int8 vending_openvending(struct map_session_data* sd, const char* message, const
 void vending_vendinglistreq(struct map_session_data* sd, int id);
 void vending_purchasereq(struct map_session_data* sd, int aid, int uid, const uint8* data, int count);
 bool vending_search(struct map_session_data* sd, t_itemid nameid);
-bool vending_searchall(struct map_session_data* sd, const struct s_search_store_search* s);
 void vending_update(map_session_data &sd);
 
 #endif /* _VENDING_HPP_ */